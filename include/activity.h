@@ -0,0 +1,67 @@
+// Author: Michele Sprocatti
+
+#ifndef ACTIVITY_H
+#define ACTIVITY_H
+
+#include <opencv2/core/types.hpp>
+#include <opencv2/core/matx.hpp>
+#include <opencv2/core/mat.hpp>
+
+/**
+ * Implementation of a monitor of the activity in the scene.
+ *
+ * The class measures the energy of the difference between consecutive frames inside the table polygon and
+ * keeps track of the state of the scene: still or in motion. It signals when the scene comes to rest after
+ * a motion, that is at the end of each shot, so that the expensive operations are done only when they carry
+ * new information.
+ */
+class SceneActivityMonitor {
+	cv::Mat mask_;	// mask of the table polygon at the working resolution.
+	cv::Mat previousGray_;	// previous frame in grayscale at the working resolution.
+	cv::Size frameSize_;	// size of the frames to analyze.
+	double scale_;	// scale factor from the frame to the working resolution.
+	double maskArea_;	// number of pixels inside the table polygon at the working resolution.
+	double energy_;	// fraction of the table pixels changed with respect to the previous frame.
+	bool moving_;	// true if the scene is in motion.
+	int movingFrames_;	// number of consecutive frames with energy above the motion threshold.
+	int stillFrames_;	// number of consecutive frames with energy below the rest threshold.
+
+public:
+	/**
+	 * @brief Constructor.
+	 * @param corners corners of the table in the frame.
+	 * @param frameSize size of the frames that will be analyzed.
+	 * @throw invalid_argument if the frame size is empty.
+	 */
+	SceneActivityMonitor(const cv::Vec<cv::Point2f, 4> &corners, const cv::Size &frameSize);
+
+	/**
+	 * @brief Start monitoring a new clip, the buffers of the previous one are reused.
+	 * @param corners corners of the table in the frame.
+	 * @param frameSize size of the frames that will be analyzed.
+	 * @throw invalid_argument if the frame size is empty.
+	 */
+	void reset(const cv::Vec<cv::Point2f, 4> &corners, const cv::Size &frameSize);
+
+	/**
+	 * @brief Update the monitor with a new frame.
+	 * @param frame new frame, BGR format requested.
+	 * @return true if the scene has just come to rest after a motion, false otherwise.
+	 * @throw invalid_argument if frame is empty or if its size is different from the one given to the constructor.
+	 */
+	bool update(const cv::Mat &frame);
+
+	/**
+	 * @brief Return the energy of the last frame.
+	 * @return the fraction of the table pixels changed with respect to the previous frame.
+	 */
+	double getEnergy() const;
+
+	/**
+	 * @brief Return if the scene is in motion.
+	 * @return true if the scene is in motion, false otherwise.
+	 */
+	bool isMoving() const;
+};
+
+#endif //ACTIVITY_H
@@ -9,14 +9,26 @@
 /**
  * Implementation of a ball.
  *
- * The class contains the information about a ball: the position, the category, the visibility
- * and the position of the same ball in a previous frame.
+ * The class contains the information about a ball: the position, the category, the visibility,
+ * the position of the same ball in a previous frame and the confidence of its detection.
+ * The position is described by the bbox and by the center, with sub-pixel precision; the center is the one of the
+ * bbox unless it is refined on the image.
  */
 class Ball {
 	cv::Rect bbox_;
 	Category category_;
 	cv::Rect bbox_prec_;
 	bool visible_;
+	float confidence_;	// confidence of the detection: Hough votes, or mean gradient on the ring for the ring template detector
+	cv::Point2f center_;	// center of the ball, with sub-pixel precision
+	cv::Point2f center_prec_;	// center of the ball in the previous frame, (-1, -1) if there is no previous frame
+
+	/**
+	 * @brief Return the center of a rectangle with sub-pixel precision.
+	 * @param rect the rectangle.
+	 * @return the center of the rectangle, (-1, -1) if the rectangle is empty.
+	 */
+	static cv::Point2f rectCenter(const cv::Rect &rect);
 
 public:
 	/**
@@ -26,14 +38,14 @@ public:
 	* @param bbox_prec bbox_prec of the ball.
 	* @param visible visibility of the ball.
 	*/
-	Ball(cv::Rect bbox, Category category, cv::Rect bbox_prec, bool visible = true) : bbox_(bbox), category_(category), bbox_prec_(bbox_prec), visible_(visible) {}
+	Ball(cv::Rect bbox, Category category, cv::Rect bbox_prec, bool visible = true) : bbox_(bbox), category_(category), bbox_prec_(bbox_prec), visible_(visible), confidence_(1), center_(rectCenter(bbox)), center_prec_(rectCenter(bbox_prec)) {}
 	/**
 	* @brief Constructor of ball when just the current is known.
 	* @param bbox bbox of the ball.
 	* @param category category of the ball.
 	* @param visible visibility of the ball.
 	*/
-	Ball(cv::Rect bbox, Category category, bool visible = true) : bbox_(bbox), category_(category),bbox_prec_(cv::Rect(-1, -1, -1, -1)),visible_(visible) {}
+	Ball(cv::Rect bbox, Category category, bool visible = true) : bbox_(bbox), category_(category),bbox_prec_(cv::Rect(-1, -1, -1, -1)),visible_(visible), confidence_(1), center_(rectCenter(bbox)), center_prec_(-1, -1) {}
 
 	/**
 	* @brief Return the rectangle containing the ball.
@@ -68,6 +80,18 @@ public:
 	 */
 	cv::Point2f getBboxCenter_prec() const;
 
+	/**
+	 * @brief Return the center of the ball with sub-pixel precision.
+	 * @return the center of the ball.
+	 */
+	cv::Point2f getCenter() const;
+
+	/**
+	 * @brief Return the center of the ball in the previous frame with sub-pixel precision.
+	 * @return the center of the ball in the previous frame, (-1, -1) if there is no previous frame.
+	 */
+	cv::Point2f getCenter_prec() const;
+
 	/**
 	 * @brief Return if the ball is inside the table area.
 	 * @return true if the ball is inside the table area, false otherwise.
@@ -75,17 +99,36 @@ public:
 	bool getVisibility() const;
 
 	/**
-	 * @brief Set a value to the rectangle of the ball.
+	 * @brief Return the confidence of the detection of the ball.
+	 * Its scale depends on the detector, so only the confidences of the same detector can be compared.
+	 * @return the confidence of the detection, higher values correspond to more reliable detections.
+	 */
+	float getConfidence() const;
+
+	/**
+	 * @brief Set a value to the rectangle of the ball, the center is moved with the rectangle.
 	 * @param bbox the new bbox position.
 	 */
 	void setBbox(const cv::Rect &bbox);
 
 	/**
-	 * @brief Set a value to the rectangle of the ball in the previous frame.
+	 * @brief Set a value to the rectangle of the ball in the previous frame, the previous center becomes its center.
 	 * @param bbox_prec the new bbox position of the previous frame.
 	 */
 	void setBbox_prec(const cv::Rect &bbox_prec);
 
+	/**
+	 * @brief Set the center of the ball with sub-pixel precision.
+	 * @param center the new center.
+	 */
+	void setCenter(const cv::Point2f &center);
+
+	/**
+	 * @brief Set the center of the ball in the previous frame with sub-pixel precision.
+	 * @param center_prec the new center of the previous frame.
+	 */
+	void setCenter_prec(const cv::Point2f &center_prec);
+
 	/**
 	 * @brief Set a value to the category of the ball.
 	 * @param category the new category.
@@ -98,6 +141,12 @@ public:
 	 * @param visible the new visibility value.
 	 */
 	void setVisibility(bool visible);
+
+	/**
+	 * @brief Set a value to the confidence of the detection of the ball.
+	 * @param confidence the new confidence value.
+	 */
+	void setConfidence(float confidence);
 };
 
 #endif // BALL_H
@@ -0,0 +1,101 @@
+// Author: Michele Sprocatti
+
+#ifndef COLORANALYSIS_H
+#define COLORANALYSIS_H
+
+#include <opencv2/core/types.hpp>
+#include <opencv2/core/matx.hpp>
+#include <opencv2/core/mat.hpp>
+#include "table.h"
+
+/**
+ * Implementation of a cache of the color information of a frame, shared by the detection and the segmentation.
+ *
+ * The frame is converted to HSV only once; the hue histogram of a region and the mask of the table color are
+ * computed the first time they are requested and then reused. The buffers are reused when the next frame is
+ * analyzed, so a pipeline can keep one analysis for the whole video.
+ */
+class FrameColorAnalysis {
+	cv::Mat hsv_;	// frame in HSV format.
+	cv::Rect histogramRegion_;	// region of the cached histogram, empty if no histogram is cached.
+	cv::Mat histogram_;	// hue histogram of histogramRegion_.
+	cv::Vec<int, 6> maskKey_;	// lower and upper HSV bounds of the cached mask, -1 if no mask is cached.
+	cv::Mat mask_;	// mask of the pixels with the color of maskKey_.
+
+public:
+	/**
+	 * @brief Constructor of an empty analysis.
+	 */
+	FrameColorAnalysis();
+
+	/**
+	 * @brief Constructor, it analyzes a frame.
+	 * @param frame frame to analyze, BGR format requested.
+	 * @throw invalid_argument if frame is empty or if frame has a number of channels different from 3.
+	 */
+	explicit FrameColorAnalysis(const cv::Mat &frame);
+
+	/**
+	 * @brief Analyze a new frame, the cached information of the previous frame is discarded.
+	 * @param frame frame to analyze, BGR format requested.
+	 * @throw invalid_argument if frame is empty or if frame has a number of channels different from 3.
+	 */
+	void analyze(const cv::Mat &frame);
+
+	/**
+	 * @brief Return the frame in HSV format.
+	 * @return the HSV frame.
+	 */
+	const cv::Mat &hsv() const;
+
+	/**
+	 * @brief Return the hue histogram of a region of the frame.
+	 * @param region region of the frame.
+	 * @return the histogram, valid until the next request of a different region.
+	 * @throw invalid_argument if the region is not inside the frame.
+	 */
+	const cv::Mat &hueHistogram(const cv::Rect &region);
+
+	/**
+	 * @brief Return the most frequent hue interval in a region of the frame.
+	 * @param region region of the frame.
+	 * @return the color interval corresponding to the most frequent Hue.
+	 * @throw invalid_argument if the region is not inside the frame.
+	 */
+	cv::Vec2b mostFrequentHue(const cv::Rect &region);
+
+	/**
+	 * @brief Return the mask of the pixels with the color of the table.
+	 * @param colorRange hue range of the table.
+	 * @param saturationThreshold minimum saturation.
+	 * @param valueThreshold minimum value.
+	 * @return the mask, valid until the next request with different parameters. It must not be modified.
+	 */
+	const cv::Mat &colorMask(cv::Vec2b colorRange, int saturationThreshold, int valueThreshold);
+
+	/**
+	 * @brief Return the mask of the pixels between two HSV bounds.
+	 * @param lower lower bound of the H, S and V channels.
+	 * @param upper upper bound of the H, S and V channels.
+	 * @return the mask, valid until the next request with different parameters. It must not be modified.
+	 */
+	const cv::Mat &colorMask(const cv::Vec3b &lower, const cv::Vec3b &upper);
+
+	/**
+	 * @brief Return the mask of the pixels with the color of a table.
+	 * @param table table with the color range or the HSV bounds of its color.
+	 * @param saturationThreshold minimum saturation, used if the table has no HSV bounds.
+	 * @param valueThreshold minimum value, used if the table has no HSV bounds.
+	 * @return the mask, valid until the next request with different parameters. It must not be modified.
+	 */
+	const cv::Mat &tableMask(const Table &table, int saturationThreshold, int valueThreshold);
+
+	/**
+	 * @brief Check if the analysis can be used for a frame.
+	 * @param frame frame to check.
+	 * @throw invalid_argument if the analysis has a different size from the frame.
+	 */
+	void checkFrame(const cv::Mat &frame) const;
+};
+
+#endif //COLORANALYSIS_H
@@ -38,6 +38,19 @@ const float TABLE_LONGEST_EDGE_CM = 250;
 const float BALL_RADIUS_CM = 2.86;
 const float TABLE_DIAMETER_CM = 215;
 
+//centers of the pockets in the minimap (the four corners and the centers of the longest edges)
+const cv::Point2f TOP_CENTER_MAP_POCKET = cv::Point2f(483, 63);
+const cv::Point2f BOTTOM_CENTER_MAP_POCKET = cv::Point2f(483, 496);
+const int NUMBER_POCKETS = 6;
+const cv::Vec<cv::Point2f, NUMBER_POCKETS> MAP_POCKETS = {TOP_LEFT_MAP_CORNER, TOP_CENTER_MAP_POCKET, TOP_RIGHT_MAP_CORNER,
+											BOTTOM_RIGHT_MAP_CORNER, BOTTOM_CENTER_MAP_POCKET, BOTTOM_LEFT_MAP_CORNER};
+
+//radius of the pockets in the minimap
+const float MAP_POCKET_RADIUS = (POCKET_DIAMETER_CM / TABLE_LONGEST_EDGE_CM) * (TOP_RIGHT_MAP_CORNER.x - TOP_LEFT_MAP_CORNER.x) / 2;
+
+//conversion from minimap pixels to centimeters
+const float MAP_PX_TO_CM = TABLE_LONGEST_EDGE_CM / (TOP_RIGHT_MAP_CORNER.x - TOP_LEFT_MAP_CORNER.x);
+
 // S>70, V>100 to be a color and not black or white
 const int S_CHANNEL_COLOR_THRESHOLD = 70;
 const int V_CHANNEL_COLOR_THRESHOLD = 100;
@@ -5,23 +5,154 @@
 
 #include <opencv2/opencv.hpp>
 #include "table.h"
+#include "category.h"
+#include "constants.h"
+#include "colorAnalysis.h"
+
+/**
+ * Parameters used to detect the table.
+ */
+struct TableDetectionParameters {
+	int dimStructuringElement = 4;	// size of the structuring element used to close the table mask.
+	int cannyThreshold1 = 200;	// first threshold of the Canny edge detector.
+	int cannyThreshold2 = 250;	// second threshold of the Canny edge detector.
+	int thresholdHough = 90;	// accumulator threshold of the Hough lines.
+	int maxLineGap = 35;	// maximum gap between points of the same Hough line.
+	int minLineLength = 155;	// minimum length of a Hough line.
+	int closePointThreshold = 50;	// distance under which two intersections are merged.
+};
+
+/**
+ * Algorithms used to find the circles of the balls.
+ */
+enum BallDetectorType {
+	HOUGH_BALL_DETECTOR = 0,	// Hough circles with a fine accumulator on the whole frame and fixed radius bounds.
+	GEOMETRIC_HOUGH_BALL_DETECTOR,	// radius bounds from the table geometry, coarse accumulator refined around each circle.
+	RING_TEMPLATE_BALL_DETECTOR	// correlation of the gradient with a ring at the expected radius, in parallel tiles.
+};
+
+/**
+ * Parameters used to detect the balls.
+ */
+struct BallDetectionParameters {
+	BallDetectorType detector = HOUGH_BALL_DETECTOR;	// algorithm used to find the circles.
+	int minRadius = 6;	// minimum radius of the Hough circles.
+	int maxRadius = 14;	// maximum radius of the Hough circles.
+	int houghParam1 = 200;	// higher threshold of the Canny edge detector used by the Hough circles.
+	int houghParam2 = 8;	// accumulator threshold of the Hough circles.
+	float inverseAccumulatorResolution = 0.1;	// inverse ratio of the accumulator resolution to the image resolution.
+	int minDistance = 19;	// minimum distance between the centers of two circles.
+	int sizeBilateral = 3;	// diameter of the bilateral filter.
+	int sigmaColor = 15;	// sigma in the color space of the bilateral filter.
+	int sigmaSpace = 70;	// sigma in the coordinate space of the bilateral filter.
+	float rangeRadius = 0.3;	// maximum relative difference between the radius of a ball and the mean radius.
+	int radiusCorners = 20;	// radius of the area around the corners of the table where balls are not searched.
+	float coarseAccumulatorResolution = 2;	// inverse accumulator resolution of the coarse Hough circles of the geometric detector, at least 2 to be coarser than the refinement.
+	int refinementMargin = 4;	// margin around a coarse circle of the region where the geometric detector refines it.
+	float ringWidth = 1.5;	// standard deviation of the profile of the ring template, in pixels; not yet tuned with ParameterSweep.
+	float ringThreshold = 20;	// minimum mean gradient on the ring template, in gray levels; not yet tuned with ParameterSweep.
+	int tileRadii = 24;	// side of the tiles of the table in ball radii.
+	bool tiled = false;	// if true the Hough detectors analyze overlapping tiles of the table in parallel.
+};
+
+/**
+ * Parameters used to classify the balls.
+ */
+struct BallClassificationParameters {
+	int meanWhiteChannel2 = 130;	// maximum mean saturation of the white ball.
+	int meanWhiteChannel3 = 160;	// minimum mean value of the white ball.
+	int meanBlackChannel3 = 115;	// maximum mean value of the black ball.
+	int numberOfBinsWhite = 3;	// the white ball has its main peak after this histogram bin.
+	int numberOfBinsBlack = 2;	// the black ball has its main peak before this histogram bin.
+	float thresholdStripedMax = 0.3;	// minimum ratio between the second and the first peak of a striped ball.
+	float thresholdDevStriped = 55;	// minimum standard deviation of the saturation of a striped ball.
+	cv::Scalar lowerMeanSkin = cv::Scalar(0, 80, 140);	// lower HSV bound of the mean color of the skin.
+	cv::Scalar upperMeanSkin = cv::Scalar(50, 100, 250);	// upper HSV bound of the mean color of the skin.
+};
+
+/**
+ * Parameters of the whole detection, by default they are the values tuned on the dataset.
+ */
+struct DetectionParameters {
+	int saturationThreshold = S_CHANNEL_COLOR_THRESHOLD;	// minimum saturation of the color of the table.
+	int valueThreshold = V_CHANNEL_COLOR_THRESHOLD;	// minimum value of the color of the table.
+	TableDetectionParameters table;
+	BallDetectionParameters balls;
+	BallClassificationParameters classification;
+};
 
 /**
  * @brief detect the corners of the table and its color in an image.
  * @param frame image where there is a table to be detected, BGR format requested.
  * @param corners output vector containing the 4 corners found.
  * @param colorRange output vector containing a range for the table colors.
+ * @param params parameters of the detection.
  * @throw runtime_error if it does not find enough lines or if it does not find enough interceptions.
  * @throw invalid_argument if frame is empty or if frame has a number of channels different from 3.
  */
-void detectTable(const cv::Mat &frame, cv::Vec<cv::Point2f, 4> &corners, cv::Vec2b &colorRange);
+void detectTable(const cv::Mat &frame, cv::Vec<cv::Point2f, 4> &corners, cv::Vec2b &colorRange,
+				 const DetectionParameters &params = DetectionParameters());
+
+/**
+ * @brief detect the corners of the table and its color in an image, using the color analysis of the image.
+ * @param frame image where there is a table to be detected, BGR format requested.
+ * @param colors color analysis of frame, shared with the other functions working on the same frame.
+ * @param corners output vector containing the 4 corners found.
+ * @param colorRange output vector containing a range for the table colors.
+ * @param params parameters of the detection.
+ * @throw runtime_error if it does not find enough lines or if it does not find enough interceptions.
+ * @throw invalid_argument if frame is empty or if frame has a number of channels different from 3
+ * 			or if colors is not the analysis of frame.
+ */
+void detectTable(const cv::Mat &frame, FrameColorAnalysis &colors, cv::Vec<cv::Point2f, 4> &corners,
+				 cv::Vec2b &colorRange, const DetectionParameters &params = DetectionParameters());
 
 /**
  * @brief detect balls in an image given some information about the table.
  * @param frame image where there are the balls to be detected, BGR format requested.
  * @param table initialized object that contains the corner and the color, the balls are added in this function.
+ * @param params parameters of the detection.
  * @throw invalid_argument if frame is empty or if frame has a number of channels different from 3.
  */
-void detectBalls(const cv::Mat &frame, Table &table);
+void detectBalls(const cv::Mat &frame, Table &table, const DetectionParameters &params = DetectionParameters());
+
+/**
+ * @brief detect balls in an image given some information about the table, using the color analysis of the image.
+ * @param frame image where there are the balls to be detected, BGR format requested.
+ * @param colors color analysis of frame, shared with the other functions working on the same frame.
+ * @param table initialized object that contains the corner and the color, the balls are added in this function.
+ * @param params parameters of the detection.
+ * @throw invalid_argument if frame is empty or if frame has a number of channels different from 3
+ * 			or if colors is not the analysis of frame.
+ */
+void detectBalls(const cv::Mat &frame, FrameColorAnalysis &colors, Table &table,
+				 const DetectionParameters &params = DetectionParameters());
+
+/**
+ * @brief classify the ball inside the image passed as argument
+ * @param img image that contains only one ball centered in the center of the ball, BGR format requested.
+ * @param radius radius of the circle that corresponds to the ball.
+ * @param params parameters of the classification.
+ * @return Category class of the ball.
+ * @throw invalid_argument if img is empty
+ * 			or if the radius is <=0 or if img has a number of channels different from 3.
+ */
+Category classificationBall(const cv::Mat &img, double radius,
+							const BallClassificationParameters &params = BallClassificationParameters());
+
+/**
+ * @brief Return the name of an algorithm used to find the circles of the balls.
+ * @param type type of the detector.
+ * @return the name of the detector.
+ */
+std::string ballDetectorName(BallDetectorType type);
+
+/**
+ * @brief Return the algorithm used to find the circles of the balls with the given name.
+ * @param name name of the detector, as returned by ballDetectorName.
+ * @return the type of the detector.
+ * @throw invalid_argument if there is no detector with the given name.
+ */
+BallDetectorType ballDetectorFromName(const std::string &name);
 
 #endif // DETECTION_H
@@ -0,0 +1,143 @@
+// Author: Alberto Pasqualetto
+
+#ifndef EVALUATION_H
+#define EVALUATION_H
+
+#include <opencv2/core/types.hpp>
+#include <opencv2/core/mat.hpp>
+#include <string>
+#include <vector>
+#include <utility>
+#include "ball.h"
+#include "category.h"
+#include "metrics.h"
+#include "detection.h"
+
+// number of categories of balls (from WHITE_BALL to STRIPED_BALL)
+const int NUMBER_BALL_CATEGORIES = 4;
+
+/**
+ * Partial result of the evaluation of the detection and of the segmentation.
+ *
+ * The class accumulates the confusion matrix of the segmentation and, for each category of balls, the list of
+ * the matched detections (confidence, true positive) and the number of ground truth balls. Partial results
+ * computed on different frames or clips can be merged, and the metrics are computed on the merged data.
+ */
+class EvaluationResult {
+	ConfusionMatrix confusion_;	// confusion matrix of the segmentation.
+	std::vector<std::pair<float, bool>> matches_[NUMBER_BALL_CATEGORIES];	// matched detections for each ball category.
+	int groundTruthCount_[NUMBER_BALL_CATEGORIES];	// number of ground truth balls for each ball category.
+	int frames_;	// number of evaluated frames.
+
+public:
+	/**
+	 * @brief Constructor of an empty result.
+	 */
+	EvaluationResult();
+
+	/**
+	 * @brief Add the evaluation of a frame.
+	 * @param detectedBalls vector of detected balls.
+	 * @param groundTruthBboxes vector of pairs of (Rect, Category) that represent the ground truth bounding boxes.
+	 * @param segmentedImage segmented image.
+	 * @param groundTruthMask ground truth mask.
+	 * @param iouThreshold Intersection over Union threshold for the detection.
+	 * @throw invalid_argument if detectedBalls is nullptr or if the segmentation cannot be compared with the mask.
+	 */
+	void addFrame(cv::Ptr<std::vector<Ball>> detectedBalls, const std::vector<std::pair<cv::Rect, Category>> &groundTruthBboxes,
+				  const cv::Mat &segmentedImage, const cv::Mat &groundTruthMask, float iouThreshold = MAP_IOU_THRESHOLD);
+
+	/**
+	 * @brief Merge another partial result in this one.
+	 * @param other partial result to merge.
+	 */
+	void merge(const EvaluationResult &other);
+
+	/**
+	 * @brief Return the Average Precision of a ball category.
+	 * @param cat Category of balls.
+	 * @return double AP value.
+	 * @throw invalid_argument if cat is not a ball category.
+	 */
+	double AP(Category cat) const;
+
+	/**
+	 * @brief Return the mean Average Precision over the ball categories.
+	 * @return double mAP value.
+	 */
+	double mAP() const;
+
+	/**
+	 * @brief Return the Intersection over Union of each category.
+	 * @return std::vector<double> vector of IoU values for each category.
+	 */
+	std::vector<double> IoUs() const;
+
+	/**
+	 * @brief Return the mean Intersection over Union over the categories.
+	 * @return double mIoU value.
+	 */
+	double mIoU() const;
+
+	/**
+	 * @brief Return the number of evaluated frames.
+	 * @return the number of frames.
+	 */
+	int getFrames() const;
+};
+
+/**
+ * Decoded frames of a clip that are compared with the ground truth.
+ */
+struct ClipFrames {
+	std::string clipPath;	// path to the folder of the clip in the dataset.
+	cv::Mat first;	// first frame of the video.
+	cv::Mat last;	// last frame of the video.
+};
+
+/**
+ * @brief Decode the first and the last frame of a clip.
+ * @param clipPath path to the folder of the clip in the dataset.
+ * @return the decoded frames of the clip.
+ * @throw invalid_argument if the video of the clip cannot be read.
+ */
+ClipFrames loadClipFrames(const std::string &clipPath);
+
+/**
+ * @brief Evaluate the detection and the segmentation in the first and the last frame of a clip.
+ * @param frames decoded frames of the clip.
+ * @param params parameters of the detection.
+ * @return the result of the evaluation of the clip.
+ * @throw runtime_error if the table cannot be detected.
+ */
+EvaluationResult evaluateClip(const ClipFrames &frames, const DetectionParameters &params = DetectionParameters());
+
+/**
+ * @brief Evaluate the detection and the segmentation in the first and the last frame of a clip.
+ * @param clipPath path to the folder of the clip in the dataset.
+ * @return the result of the evaluation of the clip.
+ * @throw invalid_argument if the video of the clip cannot be read.
+ */
+EvaluationResult evaluateClip(const std::string &clipPath);
+
+/**
+ * @brief Evaluate all the clips in parallel.
+ * @param clipPaths paths to the folders of the clips in the dataset.
+ * @param clipResults output vector containing the result of each clip, in the same order of clipPaths.
+ * @return the result of the whole dataset.
+ * @throw runtime_error if the evaluation of a clip fails.
+ */
+EvaluationResult evaluateDataset(const std::vector<std::string> &clipPaths, std::vector<EvaluationResult> &clipResults);
+
+/**
+ * @brief Evaluate all the already decoded clips in parallel with the given parameters.
+ * @param clips decoded frames of the clips.
+ * @param params parameters of the detection.
+ * @param clipResults output vector containing the result of each clip, in the same order of clips.
+ * @return the result of the whole dataset.
+ * @throw runtime_error if the evaluation of a clip fails.
+ */
+EvaluationResult evaluateDataset(const std::vector<ClipFrames> &clips, const DetectionParameters &params,
+								 std::vector<EvaluationResult> &clipResults);
+
+#endif //EVALUATION_H
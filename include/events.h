@@ -0,0 +1,118 @@
+// Author: Michela Schibuola
+
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <opencv2/core/types.hpp>
+#include <opencv2/core/mat.hpp>
+#include <string>
+#include <vector>
+#include "ball.h"
+#include "transformation.h"
+
+/**
+ * Types of the events that happen during a game.
+ */
+enum EventType {
+	POT_EVENT = 0,		// a ball enters a pocket
+	COLLISION_EVENT,	// two balls hit each other
+	CUE_STRIKE_EVENT	// the white ball is hit by the cue
+};
+
+/**
+ * Event detected in a frame of the video.
+ */
+struct PoolEvent {
+	EventType type;
+	int frame;				// number of the frame in which the event is detected, starting from 1
+	double timestamp;		// time of the event from the start of the video, in seconds
+	int ballIndex;			// index of the ball in the vector of balls
+	int otherBallIndex;		// index of the other ball of a collision, -1 for the other events
+	int pocketIndex;		// index of the pocket (as in MAP_POCKETS) of a pot event, -1 for the other events
+	cv::Point2f position;	// position of the ball in the minimap
+};
+
+/**
+ * Implementation of the detector of the game events.
+ *
+ * The class keeps the position and the velocity of each ball in the minimap coordinates and, frame by frame,
+ * it detects the balls that are scored, the collisions between balls and the strikes of the cue ball.
+ * The detected events are kept in a timestamped stream that can be written to a file.
+ */
+class EventDetector {
+	cv::Ptr<std::vector<Ball>> balls_;	// pointer to the vector of balls, the same used by the tracker.
+	double fps_;	// frame rate of the video, used to compute timestamps and velocities.
+	std::vector<std::vector<cv::Point2f>> pocketZones_;	// pocket zones in the frame coordinates.
+	std::vector<cv::Point2f> positions_;	// last known positions of the balls in the minimap.
+	std::vector<cv::Point2f> velocities_;	// smoothed velocities of the balls in cm/s.
+	std::vector<bool> hasPosition_;	// false until the first position of the ball is known.
+	std::vector<bool> scored_;	// true if the ball has already been scored.
+	std::vector<int> lastCollisionFrame_;	// frame of the last collision of each pair of balls (row-major matrix).
+	int restFrames_;	// number of consecutive frames in which the white ball has been at rest.
+	std::vector<PoolEvent> events_;	// stream of the detected events.
+
+	/**
+	 * @brief Create an event and add it to the stream.
+	 * @param type type of the event.
+	 * @param frame number of the frame of the event.
+	 * @param ballIndex index of the ball.
+	 * @param otherBallIndex index of the other ball, -1 if not needed.
+	 * @param pocketIndex index of the pocket, -1 if not needed.
+	 */
+	void addEvent(EventType type, int frame, int ballIndex, int otherBallIndex = -1, int pocketIndex = -1);
+
+public:
+	/**
+	 * @brief Constructor.
+	 * @param balls pointer to the vector of balls.
+	 * @param transform transformation matrix from the frame to the minimap.
+	 * @param fps frame rate of the video.
+	 * @throw invalid_argument if balls is nullptr, if the transform is empty or if fps is not positive.
+	 */
+	EventDetector(cv::Ptr<std::vector<Ball>> balls, const cv::Mat &transform, double fps);
+
+	/**
+	 * @brief Start detecting the events of a new clip, the buffers of the previous one are reused.
+	 * @param balls pointer to the vector of balls.
+	 * @param transform transformation matrix from the frame to the minimap.
+	 * @param fps frame rate of the video.
+	 * @throw invalid_argument if balls is nullptr, if the transform is empty or if fps is not positive.
+	 */
+	void reset(cv::Ptr<std::vector<Ball>> balls, const cv::Mat &transform, double fps);
+
+	/**
+	 * @brief Update the state of the balls and detect the events of the current frame.
+	 * @param frame number of the current frame, starting from 1.
+	 * @param positions positions of the balls in the minimap in the current frame.
+	 * @return number of events detected in the current frame.
+	 */
+	int update(int frame, const MinimapPositions &positions);
+
+	/**
+	 * @brief Return the pocket zones in the frame coordinates.
+	 * @return a vector of polygons, one for each pocket in the same order of MAP_POCKETS.
+	 */
+	const std::vector<std::vector<cv::Point2f>> &getPocketZones() const;
+
+	/**
+	 * @brief Return the stream of the detected events.
+	 * @return the events ordered by frame.
+	 */
+	const std::vector<PoolEvent> &getEvents() const;
+
+	/**
+	 * @brief Write the stream of the events in a CSV file.
+	 * @param path path of the output file.
+	 * @throw runtime_error if the file cannot be opened.
+	 */
+	void writeEvents(const std::string &path) const;
+};
+
+/**
+ * @brief Return a readable name of the event type.
+ * @param type type of the event.
+ * @return the name of the event type.
+ */
+std::string eventTypeName(EventType type);
+
+#endif //EVENTS_H
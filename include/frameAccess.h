@@ -0,0 +1,118 @@
+// Author: Michele Sprocatti
+
+#ifndef FRAMEACCESS_H
+#define FRAMEACCESS_H
+
+#include <opencv2/core/mat.hpp>
+#include <opencv2/videoio.hpp>
+#include <map>
+#include <mutex>
+#include <string>
+#include "metrics.h"
+#include "mappedFile.h"
+
+// name of the binary cache of the decoded frames, saved in the folder of each clip
+const std::string DECODED_FRAMES_CACHE_NAME = "decoded_frames.cache";
+
+/**
+ * Implementation of a random access reader of the frames of a video.
+ *
+ * A frame is reached by seeking with CAP_PROP_POS_FRAMES and the position reported by the decoder after the read
+ * is used to verify the seek. If the seek is not accurate, the video is reopened and the frames before the
+ * requested one are only grabbed, without converting or copying them.
+ */
+class FrameReader {
+	std::string videoPath_;	// path of the video.
+	cv::VideoCapture video_;	// decoder of the video.
+	int position_;	// index of the next frame returned by the decoder.
+	int frameCount_;	// number of frames, -1 if it is not known yet.
+
+	/**
+	 * @brief Reopen the video and grab the frames until the requested one, then read it.
+	 * @param index index of the frame, starting from 0.
+	 * @param frame output frame.
+	 * @return true if the frame has been read.
+	 */
+	bool readSequential(int index, cv::Mat &frame);
+
+public:
+	/**
+	 * @brief Constructor.
+	 * @param videoPath path of the video.
+	 * @throw invalid_argument if the video cannot be opened.
+	 */
+	explicit FrameReader(const std::string &videoPath);
+
+	/**
+	 * @brief Return the exact number of frames of the video.
+	 * The number stored in the container is not always reliable, so the first call counts the frames.
+	 * @return the number of frames.
+	 */
+	int getFrameCount();
+
+	/**
+	 * @brief Read a frame of the video.
+	 * @param index index of the frame, starting from 0.
+	 * @param frame output frame.
+	 * @return true if the frame has been read, false if it does not exist.
+	 */
+	bool read(int index, cv::Mat &frame);
+
+	/**
+	 * @brief Read the last frame of the video.
+	 * @param frame output frame.
+	 * @return true if the frame has been read, false if the video is empty.
+	 */
+	bool readLast(cv::Mat &frame);
+};
+
+/**
+ * Implementation of a store of the first and the last frame of the clips of the dataset.
+ *
+ * The frames of each clip are decoded only once and kept in memory. They are also saved in a raw binary cache in
+ * the folder of the clip, so the next runs map the cache in memory instead of decoding the video. The cache is
+ * rebuilt when it is older than the video. The store can be used by different threads.
+ */
+class FrameStore {
+	/**
+	 * First and last frame of a clip.
+	 */
+	struct ClipFrames {
+		cv::Ptr<MappedFile> cache;	// mapped cache, it owns the memory of the frames if they are loaded from it.
+		cv::Mat frames[2];	// first and last frame.
+	};
+
+	std::map<std::string, ClipFrames> clips_;	// frames of the loaded clips, the key is the clip path.
+	std::mutex mutex_;	// protects clips_.
+
+	/**
+	 * @brief Load the frames of a clip from the cache or from the video.
+	 * @param clipPath path to the folder of the clip.
+	 * @return the frames of the clip.
+	 * @throw invalid_argument if the video cannot be read.
+	 */
+	ClipFrames loadClip(const std::string &clipPath);
+
+public:
+	/**
+	 * @brief Return the store shared by the whole program.
+	 * @return the store.
+	 */
+	static FrameStore &instance();
+
+	/**
+	 * @brief Return a frame of a clip, loading it if needed.
+	 * @param clipPath path to the folder of the clip.
+	 * @param frameN Set to FIRST for the first frame, LAST for the last frame.
+	 * @return the frame in BGR format, valid until the store is cleared. It must not be modified.
+	 * @throw invalid_argument if frameN is not FIRST or LAST or if the video cannot be read.
+	 */
+	const cv::Mat &get(const std::string &clipPath, FrameN frameN);
+
+	/**
+	 * @brief Remove all the loaded clips from memory.
+	 */
+	void clear();
+};
+
+#endif //FRAMEACCESS_H
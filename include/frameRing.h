@@ -0,0 +1,71 @@
+// Author: Michele Sprocatti
+
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include <opencv2/core/mat.hpp>
+#include <opencv2/videoio.hpp>
+#include <vector>
+
+#include "sharedFrames.h"
+
+/**
+ * Implementation of a ring buffer of the last decoded frames of a video.
+ *
+ * The decoder writes directly into a spare slot, which is then swapped with the oldest frame of the ring, so no
+ * frame is ever copied and, since all the frames have the same size, no memory is allocated after the first
+ * frames. The last frames are kept for the detection at the end of the clip, re-detection or replay.
+ * A frame returned by the buffer is valid until it is evicted by the following reads.
+ */
+class FrameRingBuffer {
+	std::vector<cv::Mat> slots_;	// retained frames.
+	cv::Mat spare_;	// slot where the next frame is decoded, it holds the memory of the last evicted frame.
+	int newest_;	// index in slots_ of the most recent frame.
+	int size_;	// number of retained frames.
+
+public:
+	/**
+	 * @brief Constructor.
+	 * @param capacity maximum number of retained frames.
+	 * @throw invalid_argument if capacity is less than 1.
+	 */
+	explicit FrameRingBuffer(int capacity);
+
+	/**
+	 * @brief Decode the next frame of the video into the buffer.
+	 * If the read fails the retained frames are not modified.
+	 * @param video video to read.
+	 * @return true if a frame has been read, false at the end of the video.
+	 */
+	bool read(cv::VideoCapture &video);
+
+	/**
+	 * @brief Read the next frame of a shared memory stream into the buffer, without copies.
+	 * The source must retain at least the capacity of the buffer, and a buffer must not mix the two kinds of input.
+	 * @param source stream to read.
+	 * @return true if a frame has been read, false at the end of the stream.
+	 */
+	bool read(SharedFrameSource &source);
+
+	/**
+	 * @brief Return a retained frame.
+	 * @param age 0 for the most recent frame, 1 for the previous one and so on.
+	 * @return the frame.
+	 * @throw invalid_argument if the frame is not retained.
+	 */
+	const cv::Mat &get(int age = 0) const;
+
+	/**
+	 * @brief Return the number of retained frames.
+	 * @return the number of frames.
+	 */
+	int size() const;
+
+	/**
+	 * @brief Return the maximum number of retained frames.
+	 * @return the capacity.
+	 */
+	int capacity() const;
+};
+
+#endif //FRAMERING_H
@@ -0,0 +1,87 @@
+// Author: Alberto Pasqualetto
+
+#ifndef GROUNDTRUTH_H
+#define GROUNDTRUTH_H
+
+#include <opencv2/core/types.hpp>
+#include <opencv2/core/mat.hpp>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "category.h"
+#include "metrics.h"
+#include "mappedFile.h"
+
+// name of the binary cache of the ground truth, saved in the folder of each clip
+const std::string GROUND_TRUTH_CACHE_NAME = "ground_truth.cache";
+
+/**
+ * Ground truth of a frame of the dataset.
+ */
+struct GroundTruthFrame {
+	cv::Mat mask;	// category of each pixel
+	std::vector<std::pair<cv::Rect, Category>> bboxes;	// bounding boxes of the balls with their category
+};
+
+/**
+ * Implementation of a store of the ground truth of the dataset.
+ *
+ * The ground truth of each clip is loaded only once and kept in memory. The masks and the bounding boxes are
+ * saved in a binary cache in the folder of the clip, so the next runs map the cache in memory instead of decoding
+ * the PNG masks and parsing the text files. The cache is rebuilt when it is older than the original files.
+ * The store is shared by all the evaluators and it can be used by different threads: different clips are loaded
+ * concurrently, while the threads that need a clip that is being loaded wait for it.
+ */
+class GroundTruthStore {
+	/**
+	 * Ground truth of the first and the last frame of a clip.
+	 */
+	struct ClipGroundTruth {
+		cv::Ptr<MappedFile> cache;	// mapped cache, it owns the memory of the masks if they are loaded from it.
+		GroundTruthFrame frames[2];	// ground truth of the first and the last frame.
+	};
+
+	/**
+	 * Entry of a clip in the store, it is loaded once by the first thread that needs it.
+	 */
+	struct ClipEntry {
+		std::once_flag loaded;	// set when the clip has been loaded.
+		ClipGroundTruth clip;	// ground truth of the clip, valid when loaded is set.
+	};
+
+	std::map<std::string, ClipEntry> clips_;	// entries of the requested clips, the key is the clip path.
+	std::mutex mutex_;	// protects clips_, but not the loading of the entries.
+
+	/**
+	 * @brief Load the ground truth of a clip from the cache or from the original files.
+	 * @param clipPath path to the folder of the clip.
+	 * @return the ground truth of the clip.
+	 * @throw invalid_argument if the original files are not found.
+	 */
+	ClipGroundTruth loadClip(const std::string &clipPath);
+
+public:
+	/**
+	 * @brief Return the store shared by the whole program.
+	 * @return the store.
+	 */
+	static GroundTruthStore &instance();
+
+	/**
+	 * @brief Return the ground truth of a frame of a clip, loading it if needed.
+	 * @param clipPath path to the folder of the clip.
+	 * @param frameN Set to FIRST for the first frame, LAST for the last frame.
+	 * @return the ground truth of the frame, valid until the store is cleared. The mask must not be modified.
+	 * @throw invalid_argument if frameN is not FIRST or LAST or if the original files are not found.
+	 */
+	const GroundTruthFrame &get(const std::string &clipPath, FrameN frameN);
+
+	/**
+	 * @brief Remove all the loaded clips from memory.
+	 */
+	void clear();
+};
+
+#endif //GROUNDTRUTH_H
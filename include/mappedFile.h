@@ -0,0 +1,51 @@
+// Author: Alberto Pasqualetto
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * Implementation of a file mapped in memory.
+ *
+ * The content of the file is mapped in memory when the platform supports it, otherwise it is read in a buffer.
+ * The mapping is private: the content can be modified in memory without modifying the file.
+ */
+class MappedFile {
+	unsigned char *data_;	// pointer to the content of the file.
+	size_t size_;	// size of the file in bytes.
+	bool mapped_;	// true if the content is memory mapped, false if it is read in the buffer.
+	std::vector<unsigned char> buffer_;	// content of the file when memory mapping is not available.
+
+public:
+	/**
+	 * @brief Constructor.
+	 * @param path path of the file to map.
+	 * @throw runtime_error if the file cannot be opened or mapped.
+	 */
+	explicit MappedFile(const std::string &path);
+
+	/**
+	 * @brief Destructor, it releases the mapping.
+	 */
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	/**
+	 * @brief Return the content of the file.
+	 * @return a pointer to the first byte of the file.
+	 */
+	unsigned char *data() const;
+
+	/**
+	 * @brief Return the size of the file.
+	 * @return the size of the file in bytes.
+	 */
+	size_t size() const;
+};
+
+#endif //MAPPEDFILE_H
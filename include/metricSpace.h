@@ -0,0 +1,100 @@
+// Author: Michela Schibuola
+
+#ifndef METRICSPACE_H
+#define METRICSPACE_H
+
+#include <opencv2/core/types.hpp>
+#include <opencv2/core/mat.hpp>
+#include <vector>
+#include "ball.h"
+#include "transformation.h"
+
+/**
+ * @brief Convert a position in the minimap to the table coordinates.
+ * @param mapPosition position in the minimap, in pixels.
+ * @return position on the playing field in centimeters, from the top left corner.
+ */
+cv::Point2f minimapToTable(const cv::Point2f &mapPosition);
+
+/**
+ * @brief Compute the transformation from the frame to the table coordinates.
+ * @param transform transformation matrix from the frame to the minimap, as computed by computeTransformation.
+ * @return the transformation matrix from the frame to the playing field in centimeters.
+ * @throw invalid_argument if the transformation matrix in input is empty.
+ */
+cv::Mat computeTableTransformation(const cv::Mat &transform);
+
+/**
+ * Position, velocity and acceleration of a ball on the table.
+ */
+struct BallKinematics {
+	bool valid;	// false if the ball has not been on the playing field in all the frames of the window.
+	cv::Point2f position;	// smoothed position in cm, from the top left corner of the playing field.
+	cv::Point2f velocity;	// velocity in cm/s.
+	cv::Point2f acceleration;	// acceleration in cm/s^2.
+	float speed;	// norm of the velocity in cm/s.
+};
+
+/**
+ * Implementation of the estimation of the motion of the balls in the table coordinates.
+ *
+ * The positions of the balls in the minimap are converted to centimeters and kept in a sliding window of frames.
+ * Position, velocity and acceleration are estimated with a Savitzky-Golay filter, that is a least squares fit of a
+ * quadratic polynomial to the window, evaluated in its central frame: the estimates are smooth and they are
+ * available with a fixed lag of half the window. The cost is a few multiplications per ball and frame.
+ */
+class BallMotionEstimator {
+	double fps_;	// frame rate of the video.
+	int halfWindow_;	// number of frames before and after the estimated frame.
+	cv::Mat coefficients_;	// 3 x window matrix, the rows give the coefficients of the fitted polynomial.
+	std::vector<cv::Point2f> samples_;	// positions in cm, the window of each ball is a ring of window elements.
+	std::vector<bool> validSamples_;	// validity of each element of samples_.
+	std::vector<BallKinematics> kinematics_;	// estimates of the lagged frame.
+	int frame_;	// number of the last updated frame.
+
+public:
+	/**
+	 * @brief Constructor.
+	 * @param fps frame rate of the video.
+	 * @param halfWindow number of frames before and after the estimated frame, it is the lag of the estimates.
+	 * @throw invalid_argument if fps is not positive or if halfWindow is less than 1.
+	 */
+	explicit BallMotionEstimator(double fps, int halfWindow = 3);
+
+	/**
+	 * @brief Start estimating the motion in a new clip, the window and its coefficients are kept.
+	 * @param fps frame rate of the video.
+	 * @throw invalid_argument if fps is not positive.
+	 */
+	void reset(double fps);
+
+	/**
+	 * @brief Add the positions of the balls in a new frame and estimate the motion in the lagged frame.
+	 * @param frame number of the new frame, starting from 1.
+	 * @param positions positions of the balls in the minimap in the new frame.
+	 * @param balls balls of the new frame, the balls that are not visible are not sampled.
+	 * @return the estimates of the balls in the frame getLaggedFrame().
+	 * @throw invalid_argument if positions and balls have different sizes.
+	 */
+	const std::vector<BallKinematics> &update(int frame, const MinimapPositions &positions, const std::vector<Ball> &balls);
+
+	/**
+	 * @brief Return the estimates of the balls in the lagged frame.
+	 * @return the estimates, one for each ball.
+	 */
+	const std::vector<BallKinematics> &getKinematics() const;
+
+	/**
+	 * @brief Return the frame of the estimates, that is the last updated frame minus the lag.
+	 * @return the number of the frame, less than 1 if no frame has been estimated yet.
+	 */
+	int getLaggedFrame() const;
+
+	/**
+	 * @brief Return the lag of the estimates.
+	 * @return the number of frames between the last updated frame and the frame of the estimates.
+	 */
+	int getLag() const;
+};
+
+#endif //METRICSPACE_H
@@ -4,6 +4,7 @@
 #define METRICS_H
 
 #include <opencv2/core/types.hpp>
+#include <opencv2/core/matx.hpp>
 #include <string>
 #include <filesystem>
 #include <utility>
@@ -19,6 +20,12 @@ enum FrameN {
 
 const float MAP_IOU_THRESHOLD = 0.5;
 
+// number of categories in the segmentation (from BACKGROUND to PLAYING_FIELD)
+const int NUMBER_CATEGORIES = 6;
+
+// confusion matrix of the segmentation: rows are the ground truth categories, columns the predicted ones
+typedef cv::Matx<double, NUMBER_CATEGORIES, NUMBER_CATEGORIES> ConfusionMatrix;
+
 
 /**
  * @brief Compute the Intersection over Union between the segmented image and the ground truth mask.
@@ -59,6 +66,16 @@ std::vector<std::pair<cv::Rect, Category>> readGroundTruthBboxFile(const std::st
  */
 std::vector<double> APDetection(cv::Ptr<std::vector<Ball>> detectedBalls, const std::string &groundTruthBboxPath, float iouThreshold = MAP_IOU_THRESHOLD);
 
+/**
+ * @brief Compute the Average Precision (AP) for balls detection.
+ * @param detectedBalls vector of detected balls.
+ * @param groundTruthBboxes ground truth bounding boxes with their category.
+ * @param iouThreshold Intersection over Union threshold.
+ * @return std::vector<double> vector of AP values for each category.
+ * @throw invalid_argument if the vector of detected balls is empty.
+ */
+std::vector<double> APDetection(cv::Ptr<std::vector<Ball>> detectedBalls, const std::vector<std::pair<cv::Rect, Category>> &groundTruthBboxes, float iouThreshold = MAP_IOU_THRESHOLD);
+
 /**
  * @brief Compute the Intersection over Union between the segmented image and the ground truth mask.
  * @param segmentedImage segmented image.
@@ -68,6 +85,34 @@ std::vector<double> APDetection(cv::Ptr<std::vector<Ball>> detectedBalls, const
  */
 std::vector<double> IoUSegmentation(const cv::Mat &segmentedImage, const std::string& groundTruthMaskPath);
 
+/**
+ * @brief Compute the Intersection over Union between the segmented image and the ground truth mask.
+ * @param segmentedImage segmented image.
+ * @param groundTruthMask ground truth mask, one category label for each pixel.
+ * @return std::vector<double> vector of IoU values for each category.
+ * @throw invalid_argument if one of the images is empty, if they have different sizes,
+ * 			if the segmented image contains a color not associated to a category.
+ */
+std::vector<double> IoUSegmentation(const cv::Mat &segmentedImage, const cv::Mat &groundTruthMask);
+
+/**
+ * @brief Compute the confusion matrix between the segmented image and the ground truth mask.
+ * @param segmentedImage segmented image, BGR format with the colors of the categories.
+ * @param groundTruthMask ground truth mask, one category label for each pixel.
+ * @return ConfusionMatrix the confusion matrix with the ground truth on the rows and the prediction on the columns.
+ * @throw invalid_argument if one of the images is empty, if they have different sizes,
+ * 			if the segmented image contains a color not associated to a category
+ * 			or if the ground truth mask contains a label not associated to a category.
+ */
+ConfusionMatrix segmentationConfusionMatrix(const cv::Mat &segmentedImage, const cv::Mat &groundTruthMask);
+
+/**
+ * @brief Compute the Intersection over Union of each category from a confusion matrix.
+ * @param confusion confusion matrix with the ground truth on the rows and the prediction on the columns.
+ * @return std::vector<double> vector of IoU values for each category.
+ */
+std::vector<double> IoUFromConfusionMatrix(const ConfusionMatrix &confusion);
+
 
 /**
  * @brief Compute the Average Precision (AP) for ball detection of a specific category.
@@ -80,6 +125,26 @@ std::vector<double> IoUSegmentation(const cv::Mat &segmentedImage, const std::st
  */
 double APBallCategory(cv::Ptr<std::vector<Ball>> &detectedBalls, const std::vector<std::pair<cv::Rect, Category>> &groundTruthBboxes, Category cat, float iouThreshold);
 
+/**
+ * @brief Match the detected balls of a category with the ground truth bounding boxes of the same category.
+ * @param detectedBalls vector of detected balls.
+ * @param groundTruthBboxes vector of pairs of (Rect, Category) that represent the ground truth bounding boxes.
+ * @param cat Category.
+ * @param iouThreshold Intersection over Union threshold.
+ * @param matches output vector where a pair (confidence, true positive) is appended for each detected ball of the category.
+ * @param groundTruthCount output counter incremented by the number of ground truth bounding boxes of the category.
+ */
+void matchDetections(const std::vector<Ball> &detectedBalls, const std::vector<std::pair<cv::Rect, Category>> &groundTruthBboxes,
+					 Category cat, float iouThreshold, std::vector<std::pair<float, bool>> &matches, int &groundTruthCount);
+
+/**
+ * @brief Compute the Average Precision (AP) from the matched detections of a category.
+ * @param matches vector of pairs (confidence, true positive), one for each detection.
+ * @param groundTruthCount number of ground truth bounding boxes of the category.
+ * @return double AP value.
+ */
+double averagePrecision(std::vector<std::pair<float, bool>> matches, int groundTruthCount);
+
 /**
  * @brief Compute the Intersection over Union between the segmented image and the ground truth mask of a specific category.
  * @param segmentedImage segmented image.
@@ -0,0 +1,158 @@
+// Author: Michele Sprocatti
+
+#ifndef POOLANALYZER_H
+#define POOLANALYZER_H
+
+#include <opencv2/core/mat.hpp>
+#include <vector>
+#include "ball.h"
+#include "table.h"
+#include "detection.h"
+#include "segmentation.h"
+#include "transformation.h"
+#include "tracking.h"
+#include "events.h"
+#include "metricSpace.h"
+#include "activity.h"
+#include "tableColorModel.h"
+
+/**
+ * Configuration of the analysis of a clip.
+ */
+struct PoolAnalyzerConfig {
+	DetectionParameters detection;	// parameters of the detection of the table and of the balls.
+	int maxTrackingStep = 1;	// maximum number of frames between two tracked frames, 1 to track all the frames.
+	int colorModelInterval = 0;	// number of frames between two updates of the color model of the table, 0 to keep the color of the first frame.
+};
+
+/**
+ * Result of the analysis of a frame.
+ */
+struct FrameResult {
+	int frame;	// number of the frame, starting from 1.
+	std::vector<Ball> balls;	// balls in the frame, interpolated if the frame has not been tracked.
+	MinimapPositions positions;	// positions of the balls in the minimap.
+	int events;	// number of events detected in the frame.
+	int kinematicsFrame;	// number of the frame of the kinematics, it is behind frame by the lag of the estimator.
+	std::vector<BallKinematics> kinematics;	// position, velocity and acceleration of the balls in kinematicsFrame.
+	bool atRest;	// true if the balls came to rest in this frame.
+	cv::Mat minimap;	// minimap with the tracks and the balls.
+	cv::Mat output;	// frame with the minimap superimposed.
+};
+
+/**
+ * Implementation of the whole analysis of a clip: detection of the table and of the balls in the first frame,
+ * tracking, minimap, events and detection in the last frame.
+ *
+ * The analyzer owns all its buffers: the results are valid until the next call and the minimap and the output image
+ * of each result are drawn in place, so their memory is reused by the following frames. The same analyzer can be
+ * reused for many clips by calling init again, which resets the tracker, the events, the motion, the activity and the
+ * color model instead of creating them again. The frames are not copied, so the analyzer can be fed directly by a
+ * ring buffer.
+ * The analyzers do not share any mutable state, so different analyzers can run concurrently on different threads.
+ */
+class PoolAnalyzer {
+	PoolAnalyzerConfig config_;	// configuration of the analysis.
+	cv::Mat minimapWithTrack_;	// minimap with the tracks of the balls of the current clip.
+	cv::Mat segmented_;	// segmentation of the first frame, or of the last one after finish.
+	IncrementalSegmenter segmenter_;	// segmentation of the table, reused for the balls until the color of the table changes.
+	FrameColorAnalysis colors_;	// color analysis of the frame being detected, its buffers are reused.
+	Table table_;	// table of the current clip, with the tracked balls.
+	cv::Mat transform_;	// transformation from the frame to the minimap.
+	cv::Ptr<FrameSkippingTracker> tracker_;	// tracker of the balls.
+	cv::Ptr<EventDetector> events_;	// detector of the events.
+	cv::Ptr<BallMotionEstimator> motion_;	// estimator of the motion of the balls in centimeters.
+	cv::Ptr<SceneActivityMonitor> activity_;	// detector of the moments in which the balls come to rest.
+	cv::Ptr<TableColorModel> colorModel_;	// adaptive model of the color of the table, null if disabled.
+	std::vector<std::vector<Ball>> interpolated_;	// balls in the skipped frames.
+	cv::Ptr<std::vector<Ball>> renderedBalls_;	// balls of the frame that is being rendered.
+	cv::Ptr<std::vector<Ball>> segmentedBalls_;	// balls of the last call of segmentCurrentBalls.
+	std::vector<FrameResult> results_;	// results of the last processed frames.
+	std::vector<cv::Mat> singleFrame_;	// header of the frame analyzed by process(const cv::Mat &).
+	int frameCount_;	// number of processed frames.
+
+	void render(const cv::Mat &frame, cv::Ptr<std::vector<Ball>> balls, FrameResult &result);
+
+public:
+	/**
+	 * @brief Constructor.
+	 * @param config configuration of the analysis.
+	 * @throw invalid_argument if the maximum tracking step is less than 1 or the color model interval is negative.
+	 */
+	explicit PoolAnalyzer(const PoolAnalyzerConfig &config = PoolAnalyzerConfig());
+
+	/**
+	 * @brief Start the analysis of a clip from its first frame.
+	 * @param firstFrame first frame of the clip, BGR format requested.
+	 * @param fps frames per second of the clip.
+	 * @return the result of the first frame.
+	 * @throw invalid_argument if the frame is empty.
+	 */
+	const FrameResult &init(const cv::Mat &firstFrame, double fps);
+
+	/**
+	 * @brief Analyze the next frame of the clip.
+	 * @param frame frame to analyze.
+	 * @return the result of the frame, valid until the next call.
+	 * @throw invalid_argument if init has not been called.
+	 */
+	const FrameResult &process(const cv::Mat &frame);
+
+	/**
+	 * @brief Analyze the next frames of the clip, tracking only the last one.
+	 * @param frames frames from the previous tracked frame, in order; they should be getStep() frames.
+	 * @return the result of each frame, valid until the next call.
+	 * @throw invalid_argument if init has not been called or frames is empty.
+	 */
+	const std::vector<FrameResult> &process(const std::vector<cv::Mat> &frames);
+
+	/**
+	 * @brief Return the number of frames to pass to the next call of process.
+	 * @return the current tracking step.
+	 */
+	int getStep() const;
+
+	/**
+	 * @brief Finish the analysis of the clip by detecting the balls in its last frame.
+	 * @param lastFrame last frame of the clip.
+	 * @throw invalid_argument if init has not been called.
+	 */
+	void finish(const cv::Mat &lastFrame);
+
+	/**
+	 * @brief Return the table of the clip with the current balls.
+	 * @return the table.
+	 */
+	Table &getTable();
+
+	/**
+	 * @brief Return the segmentation of the first frame, or of the last frame after finish.
+	 * @return the segmented image.
+	 */
+	const cv::Mat &getSegmentation() const;
+
+	/**
+	 * @brief Segment the balls of a frame on the cached segmentation of the table.
+	 * @param frame current frame, the table is segmented again on it if its color changed.
+	 * @param balls balls in the frame, for example the balls of its result.
+	 * @return the segmented image, valid until the next call. It must not be modified.
+	 * @throw invalid_argument if init has not been called.
+	 */
+	const cv::Mat &segmentCurrentBalls(const cv::Mat &frame, const std::vector<Ball> &balls);
+
+	/**
+	 * @brief Return the detector of the events of the clip.
+	 * @return the detector.
+	 * @throw invalid_argument if init has not been called.
+	 */
+	const EventDetector &getEvents() const;
+
+	/**
+	 * @brief Return the estimator of the motion of the balls of the clip.
+	 * @return the estimator.
+	 * @throw invalid_argument if init has not been called.
+	 */
+	const BallMotionEstimator &getMotion() const;
+};
+
+#endif //POOLANALYZER_H
@@ -0,0 +1,134 @@
+// Author: Michele Sprocatti
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Implementation of a profiler of the stages of the pipeline.
+ *
+ * The profiler collects the intervals measured by the ScopedTimer objects, together with the thread and the frame
+ * in which they are measured. It can print the percentiles of the duration of each stage and export all the
+ * intervals as a timeline in the Chrome trace format, readable by chrome://tracing and Perfetto.
+ * It is disabled by default: when disabled the timers only read a flag and nothing is recorded.
+ */
+class Profiler {
+	/**
+	 * Interval measured by a timer.
+	 */
+	struct Interval {
+		const char *stage;	// name of the stage, it must be a string literal.
+		std::chrono::steady_clock::time_point start;	// start of the interval.
+		std::chrono::steady_clock::duration duration;	// duration of the interval.
+		int thread;	// index of the thread that executed the stage.
+		int frame;	// frame that was processed.
+	};
+
+	std::atomic<bool> enabled_;	// flag that indicates if the intervals are recorded.
+	std::atomic<int> frame_;	// frame currently processed.
+	std::chrono::steady_clock::time_point origin_;	// time when the profiler has been enabled, origin of the trace.
+	std::vector<Interval> intervals_;	// recorded intervals.
+	std::map<std::thread::id, int> threads_;	// index assigned to each thread.
+	std::mutex mutex_;	// protects intervals_ and threads_.
+
+	/**
+	 * @brief Constructor of a disabled profiler.
+	 */
+	Profiler();
+
+public:
+	/**
+	 * @brief Return the profiler shared by the whole program.
+	 * @return the profiler.
+	 */
+	static Profiler &instance();
+
+	/**
+	 * @brief Enable or disable the recording of the intervals.
+	 * @param enabled true to record the intervals.
+	 */
+	void setEnabled(bool enabled);
+
+	/**
+	 * @brief Return if the intervals are recorded.
+	 * @return true if the profiler is enabled.
+	 */
+	bool isEnabled() const {
+		return enabled_.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Set the frame that is currently processed, it is associated with the next intervals.
+	 * @param frame number of the frame.
+	 */
+	void setFrame(int frame);
+
+	/**
+	 * @brief Record an interval.
+	 * @param stage name of the stage, it must be a string literal.
+	 * @param start start of the interval.
+	 * @param end end of the interval.
+	 */
+	void record(const char *stage, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+	/**
+	 * @brief Print the number of calls and the 50th, 95th and 99th percentile of the duration of each stage.
+	 * @param out output stream.
+	 */
+	void printSummary(std::ostream &out);
+
+	/**
+	 * @brief Save the recorded intervals as a timeline in the Chrome trace JSON format.
+	 * @param path path of the output file.
+	 * @throw invalid_argument if the file cannot be written.
+	 */
+	void writeTrace(const std::string &path);
+
+	/**
+	 * @brief Remove all the recorded intervals.
+	 */
+	void clear();
+};
+
+/**
+ * Implementation of a timer that measures the scope in which it is declared.
+ *
+ * The interval from the construction to the destruction is recorded in the profiler with the name of the stage.
+ * If the profiler is disabled at construction nothing is measured.
+ */
+class ScopedTimer {
+	const char *stage_;	// name of the stage.
+	bool active_;	// flag that indicates if the profiler was enabled at construction.
+	std::chrono::steady_clock::time_point start_;	// start of the interval.
+
+public:
+	/**
+	 * @brief Constructor, it starts the timer if the profiler is enabled.
+	 * @param stage name of the stage, it must be a string literal.
+	 */
+	explicit ScopedTimer(const char *stage) : stage_(stage), active_(Profiler::instance().isEnabled()) {
+		if (active_)
+			start_ = std::chrono::steady_clock::now();
+	}
+
+	/**
+	 * @brief Destructor, it records the interval if the timer is active.
+	 */
+	~ScopedTimer() {
+		if (active_)
+			Profiler::instance().record(stage_, start_, std::chrono::steady_clock::now());
+	}
+
+	ScopedTimer(const ScopedTimer &) = delete;
+	ScopedTimer &operator=(const ScopedTimer &) = delete;
+};
+
+#endif //PROFILER_H
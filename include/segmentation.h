@@ -6,6 +6,7 @@
 #include <opencv2/opencv.hpp>
 #include "ball.h"
 #include "table.h"
+#include "colorAnalysis.h"
 
 
 /**
@@ -17,6 +18,16 @@
  */
 void segmentTable(const cv::Mat &frame, const Table& table, cv::Mat& segmented);
 
+/**
+ * @brief segment the table in the input image, using the color analysis of the image.
+ * @param frame input image.
+ * @param colors color analysis of frame, shared with the other functions working on the same frame.
+ * @param table initialized object containing information about the table in the input image.
+ * @param segmented output image where the table is green.
+ * @throw invalid_argument if frame is empty or if frame has less than 3 channels or if colors is not the analysis of frame.
+ */
+void segmentTable(const cv::Mat &frame, FrameColorAnalysis &colors, const Table& table, cv::Mat& segmented);
+
 /**
  * @brief segment the input image by highlight the balls.
  * @param frame input image.
@@ -26,4 +37,56 @@ void segmentTable(const cv::Mat &frame, const Table& table, cv::Mat& segmented);
  */
 void segmentBalls(const cv::Mat &frame, cv::Ptr<std::vector<Ball>> balls, cv::Mat &segmented);
 
+/**
+ * Implementation of a segmentation that computes the table only once.
+ *
+ * The table and the camera are static, so the segmentation of the table and of the background is computed on the
+ * first frame and cached. The following segmentations only draw the balls on a copy of the cached image: the
+ * regions of the balls of the previous segmentation are restored from the cache and the current balls are drawn
+ * again, so the cost depends on the size of the balls and not on the size of the frame. When the color bounds of
+ * the table change (adaptive color model) the cache is stale and init must be called again on a recent frame.
+ */
+class IncrementalSegmenter {
+	cv::Mat tableSegmentation_;	// cached segmentation of the table without the balls.
+	cv::Mat segmented_;	// last segmentation with the balls.
+	std::vector<cv::Rect> drawnRegions_;	// regions of segmented_ covered by the balls.
+	std::vector<Ball> drawnBalls_;	// balls drawn in segmented_.
+	bool hasColorBounds_ = false;	// true if the cached segmentation used the HSV bounds of the color of the table.
+	cv::Vec3b colorLower_;	// lower HSV bound of the table used by the cached segmentation, valid if hasColorBounds_ is true.
+	cv::Vec3b colorUpper_;	// upper HSV bound of the table used by the cached segmentation, valid if hasColorBounds_ is true.
+
+public:
+	/**
+	 * @brief Segment the table in a frame and cache the result.
+	 * @param frame input image.
+	 * @param colors color analysis of frame, shared with the other functions working on the same frame.
+	 * @param table initialized object containing information about the table in the input image.
+	 * @param balls pointer to a vector of the balls in the image, their disks are marked as playing field.
+	 * @throw invalid_argument if frame is empty or if frame has less than 3 channels or if colors is not the analysis of frame
+	 * 			or if balls is nullptr.
+	 */
+	void init(const cv::Mat &frame, FrameColorAnalysis &colors, const Table &table, cv::Ptr<std::vector<Ball>> balls);
+
+	/**
+	 * @brief Segment the balls on the cached segmentation of the table.
+	 * @param balls pointer to a vector of the balls in the image, it can be empty.
+	 * @return the segmented image, valid until the next call. It must not be modified.
+	 * @throw invalid_argument if init has not been called or if balls is nullptr.
+	 */
+	const cv::Mat &segment(cv::Ptr<std::vector<Ball>> balls);
+
+	/**
+	 * @brief Return if the cached segmentation has been computed with the current color of the table.
+	 * @param table table whose color is compared.
+	 * @return true if init has been called and the color bounds of the table did not change since then.
+	 */
+	bool isUpToDate(const Table &table) const;
+
+	/**
+	 * @brief Return the cached segmentation of the table without the balls.
+	 * @return the segmented image.
+	 */
+	const cv::Mat &getTableSegmentation() const;
+};
+
 #endif // SEGMENTATION_H
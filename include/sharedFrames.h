@@ -0,0 +1,140 @@
+// Author: Michele Sprocatti
+
+#ifndef SHAREDFRAMES_H
+#define SHAREDFRAMES_H
+
+#include <opencv2/core/mat.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// identifier of a valid shared frame buffer, written by the producer when the buffer is ready
+const uint32_t SHARED_FRAMES_MAGIC = 0x38425346;	// "FSB8"
+const uint32_t SHARED_FRAMES_VERSION = 1;
+
+// alignment of the header and of the slots in the shared memory
+const size_t SHARED_FRAMES_ALIGNMENT = 64;
+
+/**
+ * Header at the beginning of the shared memory, followed by the slots of the frames.
+ *
+ * Protocol: frame n is stored in slot n % slotCount. The producer writes the frame in the slot and then increments
+ * written; the consumer increments released when it does not need the frame anymore. The producer writes a frame
+ * only if written - released < slotCount, so the frames used by the consumer are never overwritten. When the
+ * producer has no more frames it sets closed to 1. The consumer sets attached to 1 when it opens the buffer, so the
+ * producer does not remove it before it is used.
+ */
+struct SharedFramesHeader {
+	uint32_t magic;	// SHARED_FRAMES_MAGIC when the buffer is ready.
+	uint32_t version;	// SHARED_FRAMES_VERSION.
+	int32_t rows;	// rows of the frames.
+	int32_t cols;	// columns of the frames.
+	int32_t type;	// OpenCV type of the frames, CV_8UC3 for BGR frames.
+	uint32_t slotCount;	// number of slots.
+	uint64_t slotSize;	// size of a slot in bytes, multiple of SHARED_FRAMES_ALIGNMENT.
+	double fps;	// frames per second of the stream.
+	std::atomic<uint64_t> written;	// number of frames published by the producer.
+	std::atomic<uint64_t> released;	// number of frames released by the consumer.
+	std::atomic<uint32_t> closed;	// 1 when the producer has no more frames.
+	std::atomic<uint32_t> attached;	// 1 when a consumer is attached.
+};
+
+/**
+ * Implementation of the producer side of a ring buffer of frames in POSIX shared memory.
+ */
+class SharedFrameSink {
+	std::string name_;	// name of the shared memory object.
+	SharedFramesHeader *header_;	// header at the beginning of the mapping.
+	unsigned char *slots_;	// first slot.
+	size_t size_;	// size of the mapping.
+
+public:
+	/**
+	 * @brief Constructor, it creates the shared memory object.
+	 * @param name name of the shared memory object, it must start with '/'.
+	 * @param frameSize size of the frames.
+	 * @param type OpenCV type of the frames.
+	 * @param fps frames per second of the stream.
+	 * @param slotCount number of slots.
+	 * @throw invalid_argument if the parameters are not valid.
+	 * @throw runtime_error if the shared memory cannot be created.
+	 */
+	SharedFrameSink(const std::string &name, cv::Size frameSize, int type, double fps, int slotCount);
+
+	/**
+	 * @brief Destructor, it closes the stream and removes the shared memory object.
+	 */
+	~SharedFrameSink();
+
+	SharedFrameSink(const SharedFrameSink &) = delete;
+	SharedFrameSink &operator=(const SharedFrameSink &) = delete;
+
+	/**
+	 * @brief Wait until a consumer is attached to the buffer.
+	 */
+	void waitConsumer();
+
+	/**
+	 * @brief Wait for a free slot and return it, the next frame must be written in it.
+	 * @return a header on the memory of the slot, without copies.
+	 */
+	cv::Mat acquire();
+
+	/**
+	 * @brief Publish the frame written in the acquired slot.
+	 */
+	void publish();
+
+	/**
+	 * @brief Signal to the consumer that there are no more frames.
+	 */
+	void close();
+};
+
+/**
+ * Implementation of the consumer side of a ring buffer of frames in POSIX shared memory.
+ *
+ * The frames are returned as cv::Mat headers on the shared memory, without copies. The last frames returned are
+ * not released to the producer, so they remain valid while they are retained by the caller.
+ */
+class SharedFrameSource {
+	SharedFramesHeader *header_;	// header at the beginning of the mapping.
+	unsigned char *slots_;	// first slot.
+	size_t size_;	// size of the mapping.
+	uint64_t next_;	// index of the next frame to read.
+	int retainedFrames_;	// number of returned frames that are not released.
+
+public:
+	/**
+	 * @brief Constructor, it attaches to the shared memory object created by the producer.
+	 * @param name name of the shared memory object, it must start with '/'.
+	 * @param retainedFrames number of returned frames that remain valid.
+	 * @throw invalid_argument if the buffer has not enough slots for the retained frames.
+	 * @throw runtime_error if the shared memory cannot be opened or it is not a valid buffer.
+	 */
+	SharedFrameSource(const std::string &name, int retainedFrames);
+
+	/**
+	 * @brief Destructor, it detaches from the shared memory.
+	 */
+	~SharedFrameSource();
+
+	SharedFrameSource(const SharedFrameSource &) = delete;
+	SharedFrameSource &operator=(const SharedFrameSource &) = delete;
+
+	/**
+	 * @brief Wait for the next frame.
+	 * @param frame output header on the memory of the frame, without copies.
+	 * @return true if a frame has been read, false if the producer has no more frames.
+	 */
+	bool read(cv::Mat &frame);
+
+	/**
+	 * @brief Return the frames per second of the stream.
+	 * @return the frames per second.
+	 */
+	double getFps() const;
+};
+
+#endif //SHAREDFRAMES_H
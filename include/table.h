@@ -18,6 +18,9 @@ class Table {
 	cv::Vec2b colorRange_;	// color range of the table expressed as the 2 Hue boundaries of the range in HSV format
 	cv::Mat transform_;
 	cv::Ptr<std::vector<Ball>> balls_;
+	cv::Vec3b colorLower_;	// lower HSV bound of the color of the table, valid if hasColorBounds_ is true
+	cv::Vec3b colorUpper_;	// upper HSV bound of the color of the table, valid if hasColorBounds_ is true
+	bool hasColorBounds_ = false;	// true if the color of the table is described by HSV bounds instead of the hue range
 
 public:
 	/**
@@ -66,6 +69,20 @@ public:
 	 */
 	cv::Vec2b getColorRange() const;
 
+	/**
+	 * @brief Return true if the color of the Table is described by HSV bounds, for example by an adaptive color model.
+	 * @return true if the bounds are set.
+	 */
+	bool hasColorBounds() const;
+
+	/**
+	 * @brief Return the HSV bounds of the color of the Table.
+	 * @param lower output lower bound of the H, S and V channels.
+	 * @param upper output upper bound of the H, S and V channels.
+	 * @throw runtime_error if the bounds are not set.
+	 */
+	void getColorBounds(cv::Vec3b &lower, cv::Vec3b &upper) const;
+
 	/**
 	 * @brief Return the transformation matrix for the Table.
 	 * @return the transformation matrix.
@@ -92,6 +109,13 @@ public:
 	 */
 	void setColorRange(cv::Vec2b colorRange);
 
+	/**
+	 * @brief Set the HSV bounds of the color of the Table, they replace the hue range in the masks of the table color.
+	 * @param lower lower bound of the H, S and V channels.
+	 * @param upper upper bound of the H, S and V channels.
+	 */
+	void setColorBounds(const cv::Vec3b &lower, const cv::Vec3b &upper);
+
 	/**
 	 * @brief Set the transform matrix of the Table.
 	 * @param transform transform matrix of the Table.
@@ -0,0 +1,69 @@
+// Author: Michele Sprocatti
+
+#ifndef TABLECOLORMODEL_H
+#define TABLECOLORMODEL_H
+
+#include <opencv2/core/types.hpp>
+#include <opencv2/core/matx.hpp>
+#include <opencv2/core/mat.hpp>
+#include <vector>
+#include "ball.h"
+#include "table.h"
+
+/**
+ * Implementation of an adaptive model of the color of the table.
+ *
+ * The color of the cloth is described by a running Gaussian for each HSV channel, estimated on the confirmed table
+ * pixels: inside the table polygon, outside the balls and inside the current color bounds. The model is updated at
+ * a reduced resolution and it sets the HSV bounds of the table, so the masks of the table color follow the changes
+ * of the lighting without detecting the table again.
+ */
+class TableColorModel {
+	cv::Mat polygon_;	// mask of the table polygon at the working resolution.
+	cv::Size frameSize_;	// size of the frames to analyze.
+	double scale_;	// scale factor from the frame to the working resolution.
+	cv::Vec3d mean_;	// running mean of the H, S and V channels.
+	cv::Vec3d variance_;	// running variance of the H, S and V channels.
+	bool initialized_;	// true if the model has been estimated at least once.
+
+public:
+	/**
+	 * @brief Constructor.
+	 * @param corners corners of the table in the frame.
+	 * @param frameSize size of the frames that will be analyzed.
+	 * @throw invalid_argument if the frame size is empty.
+	 */
+	TableColorModel(const cv::Vec<cv::Point2f, 4> &corners, const cv::Size &frameSize);
+
+	/**
+	 * @brief Start modeling the table of a new clip, the buffers of the previous one are reused.
+	 * @param corners corners of the table in the frame.
+	 * @param frameSize size of the frames that will be analyzed.
+	 * @throw invalid_argument if the frame size is empty.
+	 */
+	void reset(const cv::Vec<cv::Point2f, 4> &corners, const cv::Size &frameSize);
+
+	/**
+	 * @brief Update the model with a new frame and set the color bounds of the table.
+	 * @param frame new frame, BGR format requested.
+	 * @param table table whose color bounds are updated.
+	 * @param balls balls in the frame, their pixels are excluded.
+	 * @return true if the bounds of the table have been updated, false if there were not enough table pixels.
+	 * @throw invalid_argument if frame is empty or if its size is different from the one given to the constructor.
+	 */
+	bool update(const cv::Mat &frame, Table &table, const std::vector<Ball> &balls);
+
+	/**
+	 * @brief Return the mean color of the table.
+	 * @return the running mean of the H, S and V channels.
+	 */
+	cv::Vec3d getMean() const;
+
+	/**
+	 * @brief Return the standard deviation of the color of the table.
+	 * @return the running standard deviation of the H, S and V channels.
+	 */
+	cv::Vec3d getStdDev() const;
+};
+
+#endif //TABLECOLORMODEL_H
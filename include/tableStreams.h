@@ -0,0 +1,77 @@
+// Author: Michele Sprocatti
+
+#ifndef TABLESTREAMS_H
+#define TABLESTREAMS_H
+
+#include <opencv2/core/mat.hpp>
+#include <opencv2/videoio.hpp>
+#include <string>
+#include <vector>
+#include "frameRing.h"
+#include "poolAnalyzer.h"
+
+/**
+ * Implementation of the analysis of the video of one table, fed step by step by a scheduler.
+ *
+ * Each stream owns its decoder, its ring buffer of frames, its analyzer and its encoder, so different streams can
+ * be advanced concurrently on different threads. A single stream must not be advanced by two threads at once.
+ */
+class TableStream {
+	std::string videoPath_;	// path of the input video.
+	cv::VideoCapture video_;	// decoder of the input video.
+	cv::VideoWriter writer_;	// encoder of the output video.
+	FrameRingBuffer frames_;	// last decoded frames, the frames of a tracking step wait here.
+	PoolAnalyzer analyzer_;	// analysis of the table.
+	std::vector<cv::Mat> pending_;	// headers on the frames of the current step.
+	int frameCount_;	// number of analyzed frames.
+	bool finished_;	// true when the video has been completely analyzed.
+
+public:
+	/**
+	 * @brief Constructor, it opens the videos and analyzes the first frame.
+	 * @param videoPath path of the input video.
+	 * @param outputPath path of the output video with the minimap.
+	 * @param config configuration of the analysis.
+	 * @throw invalid_argument if the input video cannot be read or the output video cannot be written.
+	 */
+	TableStream(const std::string &videoPath, const std::string &outputPath, const PoolAnalyzerConfig &config);
+
+	/**
+	 * @brief Analyze the frames of the next tracking step and write them in the output video.
+	 * @return true if there are other frames to analyze, false if the stream is finished.
+	 */
+	bool step();
+
+	/**
+	 * @brief Return the number of analyzed frames.
+	 * @return the number of frames.
+	 */
+	int getFrameCount() const;
+
+	/**
+	 * @brief Return true if the video has been completely analyzed.
+	 * @return true if the stream is finished.
+	 */
+	bool isFinished() const;
+
+	/**
+	 * @brief Return the path of the input video.
+	 * @return the path.
+	 */
+	const std::string &getVideoPath() const;
+
+	/**
+	 * @brief Return the analyzer of the table.
+	 * @return the analyzer.
+	 */
+	PoolAnalyzer &getAnalyzer();
+};
+
+/**
+ * @brief Analyze many table streams concurrently on the OpenCV thread pool.
+ * @param streams streams to analyze.
+ * @param errors output error of each stream, empty if the stream has been analyzed correctly.
+ */
+void analyzeStreams(std::vector<cv::Ptr<TableStream>> &streams, std::vector<std::string> &errors);
+
+#endif //TABLESTREAMS_H
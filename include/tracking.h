@@ -7,8 +7,18 @@
 #include <opencv2/tracking.hpp>
 #include <vector>
 
+/**
+ * @brief Compute the center of a ball with sub-pixel precision inside its bounding box.
+ * @param frame input frame, BGR format requested.
+ * @param bbox bounding box containing the ball and a border of cloth around it.
+ * @param fallback center returned when the ball cannot be separated from the cloth.
+ * @return the refined center of the ball.
+ */
+cv::Point2f refineBallCenter(const cv::Mat &frame, const cv::Rect &bbox, const cv::Point2f &fallback);
+
 /**
  * @brief Class that tracks all the balls in the input image, it relies on OpenCV TrackerCSRT class.
+ * The centers of the tracked balls are refined with sub-pixel precision.
  */
 class BilliardTracker {
 	std::vector<cv::Ptr<cv::Tracker>> ballTrackers_;	// vector of OpenCV Tracker objects, one for each ball. The index in the vector is the same as the index in ballsVec_.
@@ -27,6 +37,12 @@ public:
 	 */
 	explicit BilliardTracker(cv::Ptr<std::vector<Ball>> balls);
 
+	/**
+	 * @brief Start tracking the balls of a new clip, the trackers of the previous one are reused.
+	 * @param balls pointer to the vector of balls to track.
+	 */
+	void reset(cv::Ptr<std::vector<Ball>> balls);
+
 	/**
 	 * @brief Track the ball with the given index in the input frame.
 	 * The returned bounding box is not updated if the IoU with the previous one is too high.
@@ -46,4 +62,48 @@ public:
 	cv::Ptr<std::vector<Ball>> trackAll(const cv::Mat &frame);
 };
 
+/**
+ * @brief Class that tracks the balls only in some frames and interpolates their positions in the skipped ones.
+ * The number of frames between two tracked frames is adapted to the speed of the balls: when they are still
+ * most of the frames are skipped, when they are fast all the frames are tracked.
+ */
+class FrameSkippingTracker {
+	BilliardTracker tracker_;	// tracker used in the tracked frames.
+	cv::Ptr<std::vector<Ball>> ballsVec_;	// pointer to the vector of balls to track.
+	int maxStep_;	// maximum number of frames between two tracked frames.
+	int step_;	// current number of frames between two tracked frames.
+
+public:
+	/**
+	 * @brief Constructor.
+	 * @param balls pointer to the vector of balls to track.
+	 * @param maxStep maximum number of frames between two tracked frames, 1 to track all the frames.
+	 * @throw invalid_argument if maxStep is less than 1.
+	 */
+	FrameSkippingTracker(cv::Ptr<std::vector<Ball>> balls, int maxStep);
+
+	/**
+	 * @brief Start tracking the balls of a new clip, the trackers of the previous one are reused.
+	 * @param balls pointer to the vector of balls to track.
+	 * @param maxStep maximum number of frames between two tracked frames, 1 to track all the frames.
+	 * @throw invalid_argument if maxStep is less than 1.
+	 */
+	void reset(cv::Ptr<std::vector<Ball>> balls, int maxStep);
+
+	/**
+	 * @brief Return the number of frames to decode before the next tracked frame.
+	 * @return the current step.
+	 */
+	int getStep() const;
+
+	/**
+	 * @brief Track the balls in a frame and interpolate their positions in the skipped frames before it.
+	 * @param frame frame to track.
+	 * @param frames number of frames from the previous tracked frame to this one, this one included.
+	 * @param interpolated output balls in each skipped frame, in order; it contains frames - 1 elements.
+	 * @throw invalid_argument if frames is less than 1.
+	 */
+	void track(const cv::Mat &frame, int frames, std::vector<std::vector<Ball>> &interpolated);
+};
+
 #endif // TRACKING_H
@@ -10,6 +10,27 @@
 #include <vector>
 #include "ball.h"
 
+/**
+ * Region of the minimap in which a ball is located.
+ */
+enum MapRegion {
+	PLAYING_FIELD_REGION = 0,	// inside the table boundaries
+	POCKET_REGION,				// outside the table boundaries but inside a pocket: the ball has been scored
+	OUTSIDE_REGION				// outside the table boundaries and far from the pockets
+};
+
+/**
+ * Positions of the balls in the minimap and the region in which each of them is located.
+ * All the vectors share the same indexing of the vector of balls.
+ */
+struct MinimapPositions {
+	std::vector<cv::Point2f> current;			// positions of the balls in the minimap
+	std::vector<cv::Point2f> previous;			// positions of the balls in the minimap in the previous frame
+	std::vector<MapRegion> currentRegion;		// region of the current positions
+	std::vector<MapRegion> previousRegion;		// region of the previous positions
+	std::vector<bool> hasPrevious;				// false if the previous position of the ball is not known
+};
+
 /**
  * @brief Compute the transformation matrix.
  * @param img original image used to check the orientation of the table.
@@ -19,6 +40,45 @@
  */
 cv::Mat computeTransformation(const cv::Mat& img, cv::Vec<cv::Point2f, 4>  &imgCorners);
 
+/**
+ * @brief Classify the positions in the minimap with respect to the playing field and the pockets.
+ * @param mapPositions positions in the minimap coordinates.
+ * @param regions output vector containing the region of each position.
+ */
+void classifyMinimapPositions(const std::vector<cv::Point2f> &mapPositions, std::vector<MapRegion> &regions);
+
+/**
+ * @brief Compute the positions of the balls in the minimap and update their visibility.
+ * @param transform transformation matrix.
+ * @param balls vector of balls containing their positions in the original image.
+ * @param positions output positions of the balls in the minimap.
+ * @throw invalid_argument if the transformation matrix in input is empty
+ * @throw invalid_argument if the balls pointer is a null pointer
+ */
+void computeMinimapPositions(const cv::Mat &transform, cv::Ptr<std::vector<Ball>> balls, MinimapPositions &positions);
+
+/**
+ * @brief Draw the balls and their tracking on the minimap using the positions already computed.
+ * @param minimapWithTrack minimap image in which the tracking lines are kept.
+ * @param positions positions of the balls in the minimap.
+ * @param balls vector of balls used to compute the positions.
+ * @return minimap image with tracking lines and balls.
+ * @throw invalid_argument if the image in input is empty
+ * @throw invalid_argument if the balls pointer is a null pointer
+ */
+cv::Mat drawMinimap(cv::Mat &minimapWithTrack, const MinimapPositions &positions, cv::Ptr<std::vector<Ball>> balls);
+
+/**
+ * @brief Draw the balls and their tracking on the minimap using the positions already computed, in a given image.
+ * @param minimapWithTrack minimap image in which the tracking lines are kept.
+ * @param positions positions of the balls in the minimap.
+ * @param balls vector of balls used to compute the positions.
+ * @param minimapWithBalls output minimap image with tracking lines and balls, its buffer is reused if it has the same size.
+ * @throw invalid_argument if the image in input is empty
+ * @throw invalid_argument if the balls pointer is a null pointer
+ */
+void drawMinimap(cv::Mat &minimapWithTrack, const MinimapPositions &positions, cv::Ptr<std::vector<Ball>> balls, cv::Mat &minimapWithBalls);
+
 /**
  * @brief Draw the balls and their tracking on the minimap.
  * @param minimapWithTrack minimap image in which the tracking lines are kept.
@@ -31,4 +91,10 @@ cv::Mat computeTransformation(const cv::Mat& img, cv::Vec<cv::Point2f, 4>  &imgC
  */
 cv::Mat drawMinimap(cv::Mat &minimapWithTrack, const cv::Mat &transform, cv::Ptr<std::vector<Ball>> balls);
 
+/**
+ * @brief Return the empty minimap image.
+ * @return the minimap image in BGR format, shared by the whole program. It must not be modified.
+ */
+const cv::Mat &emptyMinimap();
+
 #endif //TRANSFORMATION_H
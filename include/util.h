@@ -45,6 +45,21 @@ void radiusInterval(float &minRadius, float &maxRadius, const cv::Vec<cv::Point2
  */
 cv::Vec2b mostFrequentHueColor(const cv::Mat &img);
 
+/**
+ * @brief calculate the histogram of the Hue channel of an image with 8 bins.
+ * @param hsvImg input image in HSV format.
+ * @param hist output histogram.
+ * @throw invalid_argument if hsvImg is empty or if hsvImg has a number of channels different from 3.
+ */
+void computeHueHistogram(const cv::Mat &hsvImg, cv::Mat &hist);
+
+/**
+ * @brief calculate the most frequent Hue interval from a histogram computed by computeHueHistogram.
+ * @param hist histogram of the Hue channel.
+ * @return Vec2b the color interval corresponding to the most frequent Hue.
+ */
+cv::Vec2b mostFrequentHueInHistogram(const cv::Mat &hist);
+
 /**
  * @brief compute intersection of two lines if there is one.
  * @param line1 first line.
@@ -75,16 +90,22 @@ void equationFormula(float x1, float y1, float x2, float y2, float &a, float &b,
  */
 void createOutputImage(const cv::Mat &frame, const cv::Mat &minimapWithBalls, cv::Mat &res);
 
+// seed of the clustering, it gives the centers used to tune the rest of the program
+const uint64_t KMEANS_SEED = 123456789;
+
 /**
  * @brief do the clustering by using only color information on the input image.
+ * The result depends only on the input and on the seed, not on the thread or on what ran before.
  * @param inputImage image to be clustered.
  * @param colors vector containing the different colors for the different clusters,
  * the size of the vector is the number of output clusters.
  * @param clusteredImage output image: original image clustered.
+ * @param seed seed of the random generator used to initialize the centers.
  * @throw invalid_argument if the input image is empty or if colors is empty
  * 							or if inputImage has a number of channels different from 3.
  */
-void kMeansClustering(const cv::Mat &inputImage, const std::vector<cv::Vec3b> &colors, cv::Mat &clusteredImage);
+void kMeansClustering(const cv::Mat &inputImage, const std::vector<cv::Vec3b> &colors, cv::Mat &clusteredImage,
+					  uint64_t seed = KMEANS_SEED);
 
 /**
  * @brief push the elements of the first vector in the right vector according to the category.
@@ -121,6 +142,15 @@ void separateResultBalls(cv::Ptr<std::vector<Ball>> balls, std::vector<Ball> &wh
  */
 void drawBoundingBoxes(const cv::Mat &img, Table &table, cv::Mat &output);
 
+/**
+ * @brief Draw the bounding boxes of the given balls and the table boundaries on the output image.
+ * @param img input image.
+ * @param table table containing the boundaries.
+ * @param balls balls in the input image.
+ * @param output output image containing the input image with the bounding boxes.
+ */
+void drawBoundingBoxes(const cv::Mat &img, const Table &table, const std::vector<Ball> &balls, cv::Mat &output);
+
 /**
  * @brief Helper function which enlarges a rectangle by a given amount of pixels on all sides.
  * @param rect rectangle to enlarge.
@@ -0,0 +1,109 @@
+// Author: Michele Sprocatti
+
+#ifndef VIDEOIO_H
+#define VIDEOIO_H
+
+#include <opencv2/core/mat.hpp>
+#include <opencv2/videoio.hpp>
+#include <string>
+#include <vector>
+
+// number of frames decoded and encoded to benchmark a configuration
+const int VIDEO_IO_BENCHMARK_FRAMES = 60;
+
+enum VideoCodec {
+	CODEC_MPEG4 = 0,	// MPEG-4 part 2 in an mp4 container, the codec used so far.
+	CODEC_H264,	// H.264 in an mp4 container.
+	CODEC_MJPEG,	// Motion JPEG in an avi container.
+	CODEC_RAW	// uncompressed frames in an avi container, never selected automatically.
+};
+
+/**
+ * Configuration of the decoder and of the encoder of the videos.
+ * The default values correspond to the default OpenCV behaviour with the MPEG-4 codec.
+ */
+struct VideoIOConfig {
+	int captureBackend = cv::CAP_ANY;	// backend of the decoder (CAP_ANY, CAP_FFMPEG, CAP_GSTREAMER, ...).
+	int captureThreads = 0;	// number of threads of the decoder, 0 to use the backend default.
+	int writerBackend = cv::CAP_ANY;	// backend of the encoder.
+	VideoCodec codec = CODEC_MPEG4;	// codec of the output video.
+	int quality = 95;	// quality of the output video between 0 and 100, used only by the built-in MJPEG encoder.
+};
+
+/**
+ * Result of the benchmark of a configuration.
+ */
+struct VideoIOBenchmark {
+	VideoIOConfig config;
+	bool available;	// true if the backend and the codec are available.
+	double fps;	// decoded or encoded frames per second.
+};
+
+/**
+ * @brief Return the fourcc code of a codec.
+ * @param codec codec of the video.
+ * @return the fourcc code.
+ */
+int codecFourcc(VideoCodec codec);
+
+/**
+ * @brief Return the extension of the container of a codec.
+ * @param codec codec of the video.
+ * @return the extension, with the dot.
+ */
+std::string codecExtension(VideoCodec codec);
+
+/**
+ * @brief Return a readable description of a configuration.
+ * @param config configuration.
+ * @return the description.
+ */
+std::string describeVideoIO(const VideoIOConfig &config);
+
+/**
+ * @brief Open a video for reading with the given configuration, on the CPU.
+ * @param capture output decoder.
+ * @param path path of the video.
+ * @param config configuration of the decoder.
+ * @return true if the video has been opened.
+ */
+bool openCapture(cv::VideoCapture &capture, const std::string &path, const VideoIOConfig &config);
+
+/**
+ * @brief Open a video for writing with the given configuration, on the CPU.
+ * @param writer output encoder.
+ * @param path path of the video, its extension should match the codec.
+ * @param fps frames per second of the video.
+ * @param frameSize size of the frames.
+ * @param config configuration of the encoder.
+ * @return true if the video has been opened.
+ */
+bool openWriter(cv::VideoWriter &writer, const std::string &path, double fps, cv::Size frameSize, const VideoIOConfig &config);
+
+/**
+ * @brief Measure the decoding speed of the available decoder configurations on a video.
+ * @param videoPath path of the video.
+ * @param frames output first frames of the video, used to benchmark the encoders.
+ * @return the result of each configuration.
+ */
+std::vector<VideoIOBenchmark> benchmarkDecoders(const std::string &videoPath, std::vector<cv::Mat> &frames);
+
+/**
+ * @brief Measure the encoding speed of the available encoder configurations.
+ * @param frames frames to encode.
+ * @param fps frames per second of the video.
+ * @return the result of each configuration.
+ */
+std::vector<VideoIOBenchmark> benchmarkEncoders(const std::vector<cv::Mat> &frames, double fps);
+
+/**
+ * @brief Select the fastest decoder and encoder for the container of a video.
+ * The choice for each container is saved in a file, so the benchmark runs only the first time.
+ * @param videoPath path of the video.
+ * @param choicesPath path of the file with the choices for each container.
+ * @return the fastest configuration.
+ * @throw invalid_argument if the video cannot be read or no encoder is available.
+ */
+VideoIOConfig selectFastestVideoIO(const std::string &videoPath, const std::string &choicesPath);
+
+#endif //VIDEOIO_H
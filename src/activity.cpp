@@ -0,0 +1,124 @@
+// Author: Michele Sprocatti
+
+#include "activity.h"
+
+#include <stdexcept>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+using namespace cv;
+using namespace std;
+
+// const used by the monitor
+const int WORKING_WIDTH = 480;	// width of the frames used to compute the energy
+const int PIXEL_DIFFERENCE_THRESHOLD = 25;	// minimum difference in gray level to consider a pixel changed
+const double MOTION_ENERGY = 0.0008;	// fraction of changed pixels to consider the scene in motion
+const double REST_ENERGY = 0.0003;	// fraction of changed pixels to consider the scene still
+const int MIN_MOVING_FRAMES = 2;	// consecutive frames above the motion energy to start a motion
+const int MIN_STILL_FRAMES = 15;	// consecutive frames below the rest energy to end a motion
+
+/**
+ * @brief Constructor.
+ * The frames are analyzed at a reduced resolution and only inside the table polygon.
+ * @param corners corners of the table in the frame.
+ * @param frameSize size of the frames that will be analyzed.
+ * @throw invalid_argument if the frame size is empty.
+ */
+SceneActivityMonitor::SceneActivityMonitor(const Vec<Point2f, 4> &corners, const Size &frameSize) {
+	reset(corners, frameSize);
+}
+
+/**
+ * @brief Start monitoring a new clip, the buffers of the previous one are reused.
+ * The mask of the table is drawn again and the motion state is cleared.
+ * @param corners corners of the table in the frame.
+ * @param frameSize size of the frames that will be analyzed.
+ * @throw invalid_argument if the frame size is empty.
+ */
+void SceneActivityMonitor::reset(const Vec<Point2f, 4> &corners, const Size &frameSize) {
+	if(frameSize.empty())
+		throw invalid_argument("Empty frame size");
+
+	frameSize_ = frameSize;
+	scale_ = min(1.0, static_cast<double>(WORKING_WIDTH) / frameSize.width);
+	Size workingSize = Size(cvRound(frameSize.width * scale_), cvRound(frameSize.height * scale_));
+
+	vector<Point> cornersInt;
+	for(int i = 0; i < 4; i++)
+		cornersInt.push_back(Point(cvRound(corners[i].x * scale_), cvRound(corners[i].y * scale_)));
+	mask_.create(workingSize, CV_8UC1);
+	mask_.setTo(0);
+	fillConvexPoly(mask_, cornersInt, 255);
+	maskArea_ = max(1, countNonZero(mask_));
+
+	previousGray_.release();
+	energy_ = 0;
+	moving_ = false;
+	movingFrames_ = 0;
+	stillFrames_ = 0;
+}
+
+/**
+ * @brief Update the monitor with a new frame.
+ * The energy is the fraction of pixels inside the table whose gray level changed more than a threshold with
+ * respect to the previous frame. The scene starts a motion when the energy is high for some frames and it comes
+ * to rest when the energy is low for a longer period (hysteresis).
+ * @param frame new frame, BGR format requested.
+ * @return true if the scene has just come to rest after a motion, false otherwise.
+ * @throw invalid_argument if frame is empty or if its size is different from the one given to the constructor.
+ */
+bool SceneActivityMonitor::update(const Mat &frame) {
+	if(frame.empty())
+		throw invalid_argument("Empty image in input");
+
+	if(frame.size() != frameSize_)
+		throw invalid_argument("Frame size different from the expected one");
+
+	Mat small, gray, difference;
+	resize(frame, small, mask_.size(), 0, 0, INTER_AREA);
+	cvtColor(small, gray, COLOR_BGR2GRAY);
+
+	if(previousGray_.empty()) {
+		previousGray_ = gray;
+		return false;
+	}
+
+	absdiff(gray, previousGray_, difference);
+	threshold(difference, difference, PIXEL_DIFFERENCE_THRESHOLD, 255, THRESH_BINARY);
+	bitwise_and(difference, mask_, difference);
+	energy_ = countNonZero(difference) / maskArea_;
+	previousGray_ = gray;
+
+	if(!moving_) {
+		movingFrames_ = energy_ > MOTION_ENERGY ? movingFrames_ + 1 : 0;
+		if(movingFrames_ >= MIN_MOVING_FRAMES) {
+			moving_ = true;
+			stillFrames_ = 0;
+		}
+		return false;
+	}
+
+	stillFrames_ = energy_ < REST_ENERGY ? stillFrames_ + 1 : 0;
+	if(stillFrames_ >= MIN_STILL_FRAMES) {
+		moving_ = false;
+		movingFrames_ = 0;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Return the energy of the last frame.
+ * @return the fraction of the table pixels changed with respect to the previous frame.
+ */
+double SceneActivityMonitor::getEnergy() const {
+	return energy_;
+}
+
+/**
+ * @brief Return if the scene is in motion.
+ * @return true if the scene is in motion, false otherwise.
+ */
+bool SceneActivityMonitor::isMoving() const {
+	return moving_;
+}
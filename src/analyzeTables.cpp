@@ -0,0 +1,84 @@
+// Author: Michele Sprocatti
+
+#include <opencv2/core.hpp>
+#include <iostream>
+#include <filesystem>
+#include <chrono>
+
+#include "tableStreams.h"
+
+using namespace std;
+using namespace cv;
+using namespace chrono;
+
+// maximum number of frames between two tracked frames when frames are skipped
+const int MAX_TRACKING_STEP = 4;
+
+// number of frames between two updates of the color model of the table when the color is adaptive
+const int COLOR_MODEL_INTERVAL = 15;
+
+/* Analyze the videos of many tables at once, as in a venue that streams several tables: each video has its own
+ pipeline and all the pipelines share the same thread pool. For each video the output video with the minimap and
+ the events are saved in the Output folder. */
+int main(int argc, char *argv[]) {
+	vector<string> videoPaths;
+	bool skipFrames = false;
+	bool adaptiveColor = false;
+	for (int i = 1; i < argc; i++) {
+		if (string(argv[i]) == "--skip-frames")
+			skipFrames = true;
+		else if (string(argv[i]) == "--adaptive-color")
+			adaptiveColor = true;
+		else
+			videoPaths.push_back(argv[i]);
+	}
+	if (videoPaths.empty()) {
+		cout << "Usage: " << argv[0] << " <video> [<video> ...] [--skip-frames] [--adaptive-color]" << endl;
+		return -1;
+	}
+
+	PoolAnalyzerConfig config;
+	config.maxTrackingStep = skipFrames ? MAX_TRACKING_STEP : 1;
+	config.colorModelInterval = adaptiveColor ? COLOR_MODEL_INTERVAL : 0;
+	filesystem::path outputPath = filesystem::path("../Output");
+	filesystem::path eventsPath = outputPath / "events";
+	filesystem::create_directories(eventsPath);
+
+	time_point<steady_clock> start = steady_clock::now();
+	vector<Ptr<TableStream>> streams;
+	for (const string &videoPath : videoPaths) {
+		// videos with the same name in different folders are distinguished by the name of the folder
+		filesystem::path path = filesystem::path(videoPath);
+		string name = path.parent_path().filename().string() + "_" + path.stem().string();
+		try {
+			streams.push_back(makePtr<TableStream>(videoPath, (outputPath / (name + "_output.mp4")).string(), config));
+		} catch (const exception &e) {
+			cout << "Error in " << videoPath << ": " << e.what() << endl;
+			return -1;
+		}
+	}
+
+	vector<string> errors;
+	analyzeStreams(streams, errors);
+	double seconds = duration<double>(steady_clock::now() - start).count();
+
+	int totalFrames = 0;
+	int result = 0;
+	for (int i = 0; i < streams.size(); i++) {
+		if (!errors[i].empty()) {
+			cout << "Error in " << streams[i]->getVideoPath() << ": " << errors[i] << endl;
+			result = -1;
+			continue;
+		}
+		filesystem::path path = filesystem::path(streams[i]->getVideoPath());
+		string name = path.parent_path().filename().string() + "_" + path.stem().string();
+		const EventDetector &events = streams[i]->getAnalyzer().getEvents();
+		events.writeEvents((eventsPath / (name + "_events.csv")).string());
+		cout << streams[i]->getVideoPath() << ": " << streams[i]->getFrameCount() << " frames, "
+			 << events.getEvents().size() << " events" << endl;
+		totalFrames += streams[i]->getFrameCount();
+	}
+	cout << "Tables: " << streams.size() << ", frames: " << totalFrames << ", time: " << seconds << " s, "
+		 << totalFrames / seconds << " frames per second" << endl;
+	return result;
+}
@@ -7,6 +7,18 @@
 
 using namespace cv;
 
+/**
+ * @brief Return the center of a rectangle with sub-pixel precision.
+ * @param rect the rectangle.
+ * @return the center of the rectangle, (-1, -1) if the rectangle is empty.
+ */
+Point2f Ball::rectCenter(const Rect &rect) {
+	if (rect.empty())
+		return Point2f(-1, -1);
+
+	return Point2f(rect.x + rect.width / 2.0f, rect.y + rect.height / 2.0f);
+}
+
 /**
  * @brief Return the rectangle containing the ball.
  * @return the bbox of the ball.
@@ -59,6 +71,22 @@ Point2f Ball::getBboxCenter_prec() const {
 	return Point(bbox_prec_.x + bbox_prec_.width / 2, bbox_prec_.y + bbox_prec_.height / 2);
 }
 
+/**
+ * @brief Return the center of the ball with sub-pixel precision.
+ * @return the center of the ball.
+ */
+Point2f Ball::getCenter() const {
+	return center_;
+}
+
+/**
+ * @brief Return the center of the ball in the previous frame with sub-pixel precision.
+ * @return the center of the ball in the previous frame, (-1, -1) if there is no previous frame.
+ */
+Point2f Ball::getCenter_prec() const {
+	return center_prec_;
+}
+
 /**
  * @brief Return if the ball is inside the table area.
  * @return true if the ball is inside the table area, false otherwise.
@@ -68,19 +96,53 @@ bool Ball::getVisibility() const {
 }
 
 /**
- * @brief Set a value to the rectangle of the ball.
+ * @brief Return the confidence of the detection of the ball.
+ * The scale depends on the detector: the Hough detectors give the votes of the accumulator, the ring template
+ * detector the mean gradient on the ring in gray levels. The AP ranks the detections by confidence, so only the
+ * confidences of the same detector can be compared.
+ * @return the confidence of the detection, higher values correspond to more reliable detections.
+ */
+float Ball::getConfidence() const {
+	return confidence_;
+}
+
+/**
+ * @brief Set a value to the rectangle of the ball, the center is moved with the rectangle.
+ * The offset of the center from the center of the rectangle is kept, so resizing the rectangle around the ball does
+ * not lose a refined center.
  * @param bbox the new bbox position.
  */
 void Ball::setBbox(const Rect &bbox) {
+	if (bbox_.empty() || bbox.empty())
+		center_ = rectCenter(bbox);
+	else
+		center_ += rectCenter(bbox) - rectCenter(bbox_);
 	bbox_ = bbox;
 }
 
 /**
- * @brief Set a value to the rectangle of the ball in the previous frame.
+ * @brief Set a value to the rectangle of the ball in the previous frame, the previous center becomes its center.
  * @param bbox_prec the new bbox position of the previous frame.
  */
 void Ball::setBbox_prec(const Rect &bbox_prec) {
 	bbox_prec_ = bbox_prec;
+	center_prec_ = rectCenter(bbox_prec);
+}
+
+/**
+ * @brief Set the center of the ball with sub-pixel precision.
+ * @param center the new center.
+ */
+void Ball::setCenter(const Point2f &center) {
+	center_ = center;
+}
+
+/**
+ * @brief Set the center of the ball in the previous frame with sub-pixel precision.
+ * @param center_prec the new center of the previous frame.
+ */
+void Ball::setCenter_prec(const Point2f &center_prec) {
+	center_prec_ = center_prec;
 }
 
 /**
@@ -102,3 +164,11 @@ void Ball::setCategory(Category category) {
 void Ball::setVisibility(bool visible) {
 	visible_ = visible;
 }
+
+/**
+ * @brief Set a value to the confidence of the detection of the ball.
+ * @param confidence the new confidence value.
+ */
+void Ball::setConfidence(float confidence) {
+	confidence_ = confidence;
+}
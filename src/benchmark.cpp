@@ -0,0 +1,294 @@
+// Author: Michele Sprocatti
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <iostream>
+#include <iomanip>
+#include <filesystem>
+#include <functional>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+
+#include "ball.h"
+#include "table.h"
+#include "detection.h"
+#include "segmentation.h"
+#include "transformation.h"
+#include "tracking.h"
+#include "metrics.h"
+#include "groundTruth.h"
+#include "util.h"
+
+using namespace std;
+using namespace cv;
+using namespace chrono;
+
+// default number of measured iterations of each stage, after one warm-up iteration
+const int DEFAULT_ITERATIONS = 10;
+
+// a stage is a regression if its median time is slower than the baseline by more than this ratio
+const double REGRESSION_TOLERANCE = 1.2;
+
+/**
+ * Timing statistics of a benchmarked stage, in milliseconds.
+ */
+struct BenchmarkResult {
+	string name;
+	int iterations;
+	double min;
+	double median;
+	double mean;
+	double stddev;
+};
+
+/**
+ * @brief Measure a stage of the pipeline.
+ * The setup is executed before each iteration and it is not measured, so the stage always works on the same input.
+ * @param name name of the benchmark.
+ * @param iterations number of measured iterations.
+ * @param setup function that prepares the input of the stage.
+ * @param run function that executes the stage.
+ * @return the timing statistics.
+ */
+BenchmarkResult measure(const string &name, int iterations, const function<void()> &setup, const function<void()> &run) {
+	vector<double> times;
+
+	// the first iteration is not measured, it fills the caches and initializes the lazy OpenCV structures
+	setup();
+	run();
+	for (int i = 0; i < iterations; i++) {
+		setup();
+		time_point<steady_clock> start = steady_clock::now();
+		run();
+		times.push_back(duration<double, milli>(steady_clock::now() - start).count());
+	}
+
+	BenchmarkResult result;
+	result.name = name;
+	result.iterations = iterations;
+	sort(times.begin(), times.end());
+	result.min = times.front();
+	result.median = (iterations % 2 == 1) ? times[iterations / 2] : (times[iterations / 2 - 1] + times[iterations / 2]) / 2;
+	result.mean = 0;
+	for (double t : times)
+		result.mean += t;
+	result.mean /= iterations;
+	result.stddev = 0;
+	for (double t : times)
+		result.stddev += (t - result.mean) * (t - result.mean);
+	result.stddev = sqrt(result.stddev / iterations);
+
+	cout << left << setw(48) << name << right << fixed << setprecision(3)
+		 << " median " << setw(10) << result.median << " ms"
+		 << "  min " << setw(10) << result.min << " ms"
+		 << "  stddev " << setw(8) << result.stddev << " ms" << endl;
+	return result;
+}
+
+/**
+ * @brief Benchmark all the stages of the pipeline on a frame of the dataset.
+ * The input of each stage is the output of the previous ones, computed once before measuring.
+ * @param clipPath path to the folder of the clip.
+ * @param frameN Set to FIRST for the first frame, LAST for the last frame.
+ * @param minimap image of the minimap.
+ * @param iterations number of measured iterations.
+ * @param results vector where the results are added.
+ */
+void benchmarkFrame(const filesystem::path &clipPath, FrameN frameN, const Mat &minimap, int iterations,
+					vector<BenchmarkResult> &results) {
+	string suffix = (frameN == FIRST) ? "first" : "last";
+	string prefix = clipPath.filename().string() + "/" + suffix + "/";
+	Mat frame = imread((clipPath / "frames" / ("frame_" + suffix + ".png")).string());
+	if (frame.empty())
+		throw invalid_argument("Frame not found in " + clipPath.string());
+
+	// detection of the table
+	Vec<Point2f, 4> tableCorners;
+	Vec2b colorTable;
+	results.push_back(measure(prefix + "detectTable", iterations, [](){}, [&]() {
+		detectTable(frame, tableCorners, colorTable);
+	}));
+	Table table = Table(tableCorners, colorTable);
+
+	// detection of the balls
+	results.push_back(measure(prefix + "detectBalls", iterations, [&]() {
+		table.clearBalls();
+	}, [&]() {
+		detectBalls(frame, table);
+	}));
+	Ptr<vector<Ball>> balls = table.ballsPtr();
+
+	// classification of all the detected balls
+	vector<Mat> ballImages;
+	vector<double> ballRadius;
+	for (const Ball &ball : *balls) {
+		ballImages.push_back(frame(ball.getBbox()));
+		ballRadius.push_back(ball.getBbox().width / 2.0);
+	}
+	results.push_back(measure(prefix + "classificationBall", iterations, [](){}, [&]() {
+		for (int i = 0; i < ballImages.size(); i++)
+			classificationBall(ballImages[i], ballRadius[i]);
+	}));
+
+	// clustering with the same colors used in the detection of the balls
+	vector<Vec3b> colors = {Vec3b(0, 0, 255), Vec3b(0, 255, 0), Vec3b(255, 0, 0), Vec3b(255, 255, 0), Vec3b(0, 255, 255)};
+	Mat clustered;
+	results.push_back(measure(prefix + "kMeansClustering", iterations, [](){}, [&]() {
+		kMeansClustering(frame, colors, clustered);
+	}));
+
+	// segmentation
+	Mat segmentedTable, segmented;
+	results.push_back(measure(prefix + "segmentTable", iterations, [](){}, [&]() {
+		segmentTable(frame, table, segmentedTable);
+	}));
+	results.push_back(measure(prefix + "segmentBalls", iterations, [&]() {
+		segmentedTable.copyTo(segmented);
+	}, [&]() {
+		segmentBalls(segmented, balls, segmented);
+	}));
+
+	// transformation and minimap
+	Vec<Point2f, 4> imgCorners;
+	Mat transform;
+	results.push_back(measure(prefix + "computeTransformation", iterations, [&]() {
+		imgCorners = table.getBoundaries();
+	}, [&]() {
+		transform = computeTransformation(segmented, imgCorners);
+	}));
+
+	Mat minimapWithTrack, minimapWithBalls;
+	results.push_back(measure(prefix + "drawMinimap", iterations, [&]() {
+		minimapWithTrack = minimap.clone();
+	}, [&]() {
+		minimapWithBalls = drawMinimap(minimapWithTrack, transform, balls);
+	}));
+
+	Mat res;
+	results.push_back(measure(prefix + "createOutputImage", iterations, [](){}, [&]() {
+		createOutputImage(frame, minimapWithBalls, res);
+	}));
+
+	// tracking, the trackers are initialized on the same frame before measuring the update
+	Ptr<vector<Ball>> trackedBalls = makePtr<vector<Ball>>(*balls);
+	BilliardTracker tracker = BilliardTracker(trackedBalls);
+	tracker.trackAll(frame);
+	results.push_back(measure(prefix + "BilliardTracker::trackAll", iterations, [](){}, [&]() {
+		tracker.trackAll(frame);
+	}));
+
+	// metrics
+	const GroundTruthFrame &groundTruth = GroundTruthStore::instance().get(clipPath.string(), frameN);
+	results.push_back(measure(prefix + "IoUSegmentation", iterations, [](){}, [&]() {
+		IoUSegmentation(segmented, groundTruth.mask);
+	}));
+	results.push_back(measure(prefix + "APBallCategory", iterations, [](){}, [&]() {
+		for (Category cat = WHITE_BALL; cat <= STRIPED_BALL; cat = static_cast<Category>(cat + 1))
+			APBallCategory(balls, groundTruth.bboxes, cat, MAP_IOU_THRESHOLD);
+	}));
+}
+
+/**
+ * @brief Save the results in JSON format.
+ * @param path path of the output file.
+ * @param results results of the benchmark.
+ */
+void writeResults(const string &path, const vector<BenchmarkResult> &results) {
+	FileStorage fs(path, FileStorage::WRITE | FileStorage::FORMAT_JSON);
+	fs << "context" << "{";
+	fs << "opencv_version" << CV_VERSION;
+	fs << "num_threads" << getNumThreads();
+	fs << "time_unit" << "ms";
+	fs << "}";
+	fs << "benchmarks" << "[";
+	for (const BenchmarkResult &result : results) {
+		fs << "{";
+		fs << "name" << result.name;
+		fs << "iterations" << result.iterations;
+		fs << "min" << result.min;
+		fs << "median" << result.median;
+		fs << "mean" << result.mean;
+		fs << "stddev" << result.stddev;
+		fs << "}";
+	}
+	fs << "]";
+}
+
+/**
+ * @brief Compare the results with a baseline saved by a previous run.
+ * @param path path of the baseline in JSON format.
+ * @param results results of the benchmark.
+ * @return the number of regressions.
+ * @throw invalid_argument if the baseline cannot be read.
+ */
+int compareWithBaseline(const string &path, const vector<BenchmarkResult> &results) {
+	FileStorage fs(path, FileStorage::READ | FileStorage::FORMAT_JSON);
+	if (!fs.isOpened())
+		throw invalid_argument("Cannot read baseline " + path);
+
+	int regressions = 0;
+	FileNode benchmarks = fs["benchmarks"];
+	for (FileNodeIterator it = benchmarks.begin(); it != benchmarks.end(); ++it) {
+		string name = (string) (*it)["name"];
+		double baselineMedian = (double) (*it)["median"];
+		for (const BenchmarkResult &result : results) {
+			if (result.name == name && result.median > REGRESSION_TOLERANCE * baselineMedian) {
+				cout << "REGRESSION " << name << ": " << result.median << " ms (baseline " << baselineMedian << " ms)" << endl;
+				regressions++;
+			}
+		}
+	}
+	return regressions;
+}
+
+/* Benchmark of every stage of the pipeline on the first and the last frame of all the clips in the dataset.
+	The results are saved in JSON format in Output/benchmark.json; if a baseline is provided, the stages slower
+	than the baseline are reported and the program returns a non zero value.
+	Usage: Benchmark [iterations] [baseline.json] */
+int main(int argc, char *argv[]) {
+	if (argc > 3) {
+		cout << "Usage: " << argv[0] << " [iterations] [baseline.json]" << endl;
+		return -1;
+	}
+	int iterations = (argc > 1) ? stoi(argv[1]) : DEFAULT_ITERATIONS;
+	if (iterations <= 0) {
+		cout << "The number of iterations must be positive" << endl;
+		return -1;
+	}
+
+	// clips of the dataset in alphabetical order, so the results of different runs can be compared
+	vector<filesystem::path> clipPaths;
+	for (const filesystem::directory_entry &entry : filesystem::directory_iterator("../Dataset"))
+		if (entry.is_directory() && filesystem::exists(entry.path() / "frames"))
+			clipPaths.push_back(entry.path());
+	sort(clipPaths.begin(), clipPaths.end());
+
+	const Mat &minimap = emptyMinimap();
+
+	vector<BenchmarkResult> results;
+	for (const filesystem::path &clipPath : clipPaths) {
+		try {
+			benchmarkFrame(clipPath, FIRST, minimap, iterations, results);
+			benchmarkFrame(clipPath, LAST, minimap, iterations, results);
+		} catch (const exception &e) {
+			cout << "Error in " << clipPath.string() << ": " << e.what() << endl;
+		}
+	}
+
+	filesystem::path outputPath = filesystem::path("../Output") / "benchmark.json";
+	filesystem::create_directories(outputPath.parent_path());
+	writeResults(outputPath.string(), results);
+	cout << "Results saved in " << outputPath.string() << endl;
+
+	if (argc == 3) {
+		int regressions = compareWithBaseline(argv[2], results);
+		cout << regressions << " regressions found" << endl;
+		if (regressions > 0)
+			return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,137 @@
+// Author: Michele Sprocatti
+
+#include "colorAnalysis.h"
+
+#include <opencv2/imgproc.hpp>
+#include <stdexcept>
+#include "util.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ * @brief Constructor of an empty analysis.
+ */
+FrameColorAnalysis::FrameColorAnalysis() {
+	histogramRegion_ = Rect();
+	maskKey_ = Vec<int, 6>::all(-1);
+}
+
+/**
+ * @brief Constructor, it analyzes a frame.
+ * @param frame frame to analyze, BGR format requested.
+ * @throw invalid_argument if frame is empty or if frame has a number of channels different from 3.
+ */
+FrameColorAnalysis::FrameColorAnalysis(const Mat &frame) : FrameColorAnalysis() {
+	analyze(frame);
+}
+
+/**
+ * @brief Analyze a new frame, the cached information of the previous frame is discarded.
+ * The buffers of the previous frame are reused when the new frame has the same size.
+ * @param frame frame to analyze, BGR format requested.
+ * @throw invalid_argument if frame is empty or if frame has a number of channels different from 3.
+ */
+void FrameColorAnalysis::analyze(const Mat &frame) {
+	if(frame.empty())
+		throw invalid_argument("Empty image in input");
+	if(frame.channels() != 3)
+		throw invalid_argument("Invalid number of channels for the input image");
+
+	cvtColor(frame, hsv_, COLOR_BGR2HSV);
+	histogramRegion_ = Rect();
+	maskKey_ = Vec<int, 6>::all(-1);
+}
+
+/**
+ * @brief Return the frame in HSV format.
+ * @return the HSV frame.
+ */
+const Mat &FrameColorAnalysis::hsv() const {
+	return hsv_;
+}
+
+/**
+ * @brief Return the hue histogram of a region of the frame.
+ * The histogram is computed only if the region is different from the one of the cached histogram.
+ * @param region region of the frame.
+ * @return the histogram, valid until the next request of a different region.
+ * @throw invalid_argument if the region is not inside the frame.
+ */
+const Mat &FrameColorAnalysis::hueHistogram(const Rect &region) {
+	if(region.empty() || (region & Rect(0, 0, hsv_.cols, hsv_.rows)) != region)
+		throw invalid_argument("Region outside the frame");
+
+	if(region != histogramRegion_) {
+		computeHueHistogram(hsv_(region), histogram_);
+		histogramRegion_ = region;
+	}
+	return histogram_;
+}
+
+/**
+ * @brief Return the most frequent hue interval in a region of the frame.
+ * @param region region of the frame.
+ * @return the color interval corresponding to the most frequent Hue.
+ * @throw invalid_argument if the region is not inside the frame.
+ */
+Vec2b FrameColorAnalysis::mostFrequentHue(const Rect &region) {
+	return mostFrequentHueInHistogram(hueHistogram(region));
+}
+
+/**
+ * @brief Return the mask of the pixels with the color of the table.
+ * The mask is computed only if the parameters are different from the ones of the cached mask: the detection of
+ * the table, the detection of the balls and the segmentation use the same color, so they share the mask.
+ * @param colorRange hue range of the table.
+ * @param saturationThreshold minimum saturation.
+ * @param valueThreshold minimum value.
+ * @return the mask, valid until the next request with different parameters. It must not be modified.
+ */
+const Mat &FrameColorAnalysis::colorMask(Vec2b colorRange, int saturationThreshold, int valueThreshold) {
+	return colorMask(Vec3b(colorRange[0], saturationThreshold, valueThreshold), Vec3b(colorRange[1], 255, 255));
+}
+
+/**
+ * @brief Return the mask of the pixels between two HSV bounds.
+ * The mask is computed only if the bounds are different from the ones of the cached mask.
+ * @param lower lower bound of the H, S and V channels.
+ * @param upper upper bound of the H, S and V channels.
+ * @return the mask, valid until the next request with different parameters. It must not be modified.
+ */
+const Mat &FrameColorAnalysis::colorMask(const Vec3b &lower, const Vec3b &upper) {
+	Vec<int, 6> key = Vec<int, 6>(lower[0], lower[1], lower[2], upper[0], upper[1], upper[2]);
+	if(key != maskKey_) {
+		inRange(hsv_, Scalar(lower[0], lower[1], lower[2]), Scalar(upper[0], upper[1], upper[2]), mask_);
+		maskKey_ = key;
+	}
+	return mask_;
+}
+
+/**
+ * @brief Return the mask of the pixels with the color of a table.
+ * If the table has HSV bounds, for example from an adaptive color model, they are used; otherwise the hue range
+ * of the table with the given thresholds.
+ * @param table table with the color range or the HSV bounds of its color.
+ * @param saturationThreshold minimum saturation, used if the table has no HSV bounds.
+ * @param valueThreshold minimum value, used if the table has no HSV bounds.
+ * @return the mask, valid until the next request with different parameters. It must not be modified.
+ */
+const Mat &FrameColorAnalysis::tableMask(const Table &table, int saturationThreshold, int valueThreshold) {
+	if(table.hasColorBounds()) {
+		Vec3b lower, upper;
+		table.getColorBounds(lower, upper);
+		return colorMask(lower, upper);
+	}
+	return colorMask(table.getColorRange(), saturationThreshold, valueThreshold);
+}
+
+/**
+ * @brief Check if the analysis can be used for a frame.
+ * @param frame frame to check.
+ * @throw invalid_argument if the analysis has a different size from the frame.
+ */
+void FrameColorAnalysis::checkFrame(const Mat &frame) const {
+	if(hsv_.size() != frame.size())
+		throw invalid_argument("The color analysis does not correspond to the frame");
+}
@@ -2,6 +2,7 @@
 
 #include <opencv2/opencv.hpp>
 #include <cmath>
+#include <algorithm>
 #include <stdexcept>
 
 #include "table.h"
@@ -9,6 +10,7 @@
 #include "detection.h"
 #include "util.h"
 #include "constants.h"
+#include "profiler.h"
 
 using namespace cv;
 using namespace std;
@@ -19,11 +21,12 @@ using namespace std;
  * the histogram and compute the two max values, using some conditions then it determines the class.
  * @param img image that contains only one ball centered in the center of the ball, BGR format requested.
  * @param radius radius of the circle that corresponds to the ball.
+ * @param params parameters of the classification.
  * @return Category class of the ball.
  * @throw invalid_argument if img is empty
  * 			or if the radius is <=0 or if img has a number of channels different from 3.
  */
-Category classificationBall(const Mat& img, double radius){
+Category classificationBall(const Mat& img, double radius, const BallClassificationParameters &params){
 
 	if(img.empty())
 		throw invalid_argument("Empty image in input");
@@ -34,15 +37,6 @@ Category classificationBall(const Mat& img, double radius){
 	if(radius <= 0)
 		throw invalid_argument("Radius negative or equal to zero");
 
-	// const to classify the ball
-	const int MEAN_WHITE_CHANNEL2 = 130;
-	const int MEAN_WHITE_CHANNEL3 = 160;
-	const int MEAN_BLACK_CHANNEL3 = 115;
-	const int NUMBER_OF_BINS_WHITE = 3;
-	const int NUMBER_OF_BINS_BLACK = 2;
-	const float THRESHOLD_STRIPED_MAX = 0.3;
-	const float THRESHOLD_DEV_STRIPED = 55;
-
 	// imshow("original", img);
 
 	Mat hist, gray, mask, hsv, argmax, argmax2;
@@ -85,29 +79,25 @@ Category classificationBall(const Mat& img, double radius){
 	meanStdDev(hsv, mean, stddev, mask);
 
 	// classification
-	if(argmax.at<int>(0) < NUMBER_OF_BINS_BLACK
-		&& mean[2] < MEAN_BLACK_CHANNEL3)
+	if(argmax.at<int>(0) < params.numberOfBinsBlack
+		&& mean[2] < params.meanBlackChannel3)
 		return BLACK_BALL;
 
-	if((argmax.at<int>(0) > NUMBER_OF_BINS_WHITE)
-		 && mean[1] < MEAN_WHITE_CHANNEL2
-		 && mean[2] > MEAN_WHITE_CHANNEL3)
+	if((argmax.at<int>(0) > params.numberOfBinsWhite)
+		 && mean[1] < params.meanWhiteChannel2
+		 && mean[2] > params.meanWhiteChannel3)
 		return WHITE_BALL;
 
 	// skin color tested, thresholds found on the web and adjusted to the dataset
-	const int LOWER_MEAN_HUE = 0;
-	const int UPPER_MEAN_HUE = 50;
-	const int LOWER_MEAN_SATURATION = 80;
-	const int UPPER_MEAN_SATURATION = 100;
-	const int LOWER_MEAN_VALUE = 140;
-	const int UPPER_MEAN_VALUE = 250;
-	if(mean[0] > LOWER_MEAN_HUE && mean[0] < UPPER_MEAN_HUE
-		&& mean[1] > LOWER_MEAN_SATURATION && mean[1] < UPPER_MEAN_SATURATION
-		&& mean[2] > LOWER_MEAN_VALUE && mean[2] < UPPER_MEAN_VALUE)
+	const Scalar &lowerSkin = params.lowerMeanSkin;
+	const Scalar &upperSkin = params.upperMeanSkin;
+	if(mean[0] > lowerSkin[0] && mean[0] < upperSkin[0]
+		&& mean[1] > lowerSkin[1] && mean[1] < upperSkin[1]
+		&& mean[2] > lowerSkin[2] && mean[2] < upperSkin[2])
 		return BACKGROUND;
 
-	if(val2 > THRESHOLD_STRIPED_MAX * val
-		&& stddev[1] > THRESHOLD_DEV_STRIPED)
+	if(val2 > params.thresholdStripedMax * val
+		&& stddev[1] > params.thresholdDevStriped)
 			return STRIPED_BALL;
 
 	return SOLID_BALL;
@@ -206,34 +196,54 @@ void nonMaximaSuppressionWhiteBlack(const Mat &img, Ptr<vector<Ball>> balls)
 
 /**
  * @brief detect the corners of the table and its color in an image.
+ * The image is analyzed only for this detection, use the overload with the color analysis to share it.
+ * @param frame image where there is a table to be detected, BGR format requested.
+ * @param corners output vector containing the 4 corners found.
+ * @param colorRange output vector containing a range for the table colors.
+ * @param params parameters of the detection.
+ * @throw runtime_error if it does not find enough lines or if it does not find enough interceptions.
+ * @throw invalid_argument if frame is empty or if frame has a number of channels different from 3.
+ */
+void detectTable(const Mat &frame, Vec<Point2f, 4> &corners, Vec2b &colorRange, const DetectionParameters &params){
+	FrameColorAnalysis colors = FrameColorAnalysis(frame);
+	detectTable(frame, colors, corners, colorRange, params);
+}
+
+/**
+ * @brief detect the corners of the table and its color in an image, using the color analysis of the image.
  * Create a mask using the most common color in the image central area, then evaluates the edge with the Canny
  * algorithm and then it uses Hough lines to detect the lines. To select the intersections, it computes them
  * and then merge the closest in order to have the four different corners.
  * @param frame image where there is a table to be detected, BGR format requested.
+ * @param colors color analysis of frame, shared with the other functions working on the same frame.
  * @param corners output vector containing the 4 corners found.
  * @param colorRange output vector containing a range for the table colors.
+ * @param params parameters of the detection.
  * @throw runtime_error if it does not find enough lines or if it does not find enough interceptions.
- * @throw invalid_argument if frame is empty or if frame has a number of channels different from 3.
+ * @throw invalid_argument if frame is empty or if frame has a number of channels different from 3
+ * 			or if colors is not the analysis of frame.
  */
-void detectTable(const Mat &frame, Vec<Point2f, 4> &corners, Vec2b &colorRange){
+void detectTable(const Mat &frame, FrameColorAnalysis &colors, Vec<Point2f, 4> &corners, Vec2b &colorRange,
+				 const DetectionParameters &params){
 
 	if(frame.empty())
 		throw invalid_argument("Empty image in input");
 	if(frame.channels() != 3)
 		throw invalid_argument("Invalid number of channels for the input image");
+	colors.checkFrame(frame);
 
 
-	// const used during the function
-	const int DIM_STRUCTURING_ELEMENT = 4;
-	const int CANNY_THRESHOLD1 = 200;
-	const int CANNY_THRESHOLD2 = 250;
-	const int THRESHOLD_HOUGH = 90;
-	const int MAX_LINE_GAP = 35;
-	const int MIN_LINE_LENGTH = 155;
-	const int CLOSE_POINT_THRESHOLD = 50;
+	// parameters used during the function
+	const int DIM_STRUCTURING_ELEMENT = params.table.dimStructuringElement;
+	const int CANNY_THRESHOLD1 = params.table.cannyThreshold1;
+	const int CANNY_THRESHOLD2 = params.table.cannyThreshold2;
+	const int THRESHOLD_HOUGH = params.table.thresholdHough;
+	const int MAX_LINE_GAP = params.table.maxLineGap;
+	const int MIN_LINE_LENGTH = params.table.minLineLength;
+	const int CLOSE_POINT_THRESHOLD = params.table.closePointThreshold;
 
 	// variables
-	Mat imgGray, imgBorder, thisImg, mask, kernel;
+	Mat imgGray, imgBorder, mask, kernel;
 	vector<Vec4i> lines;
 	int colsover4 = frame.cols/4;
 	Scalar line_color = Scalar(0, 0, 255);
@@ -241,17 +251,15 @@ void detectTable(const Mat &frame, Vec<Point2f, 4> &corners, Vec2b &colorRange){
 	vector<Vec3f> coefficients;
 
 	// get the color range for the table
-	colorRange = mostFrequentHueColor(frame.colRange(colsover4, 3*colsover4));
+	colorRange = colors.mostFrequentHue(Rect(colsover4, 0, 2*colsover4, frame.rows));
 
 	// mask the image
-	cvtColor(frame, thisImg, COLOR_BGR2HSV);
-	inRange(thisImg, Scalar(colorRange[0], S_CHANNEL_COLOR_THRESHOLD, V_CHANNEL_COLOR_THRESHOLD),
-				Scalar(colorRange[1], 255, 255), mask);
-	//imshow("Mask", mask);
+	const Mat &colorMask = colors.colorMask(colorRange, params.saturationThreshold, params.valueThreshold);
+	//imshow("Mask", colorMask);
 
 	// morphological operations
 	kernel = getStructuringElement(MORPH_RECT, Size(DIM_STRUCTURING_ELEMENT, DIM_STRUCTURING_ELEMENT));
-	morphologyEx(mask, mask, MORPH_CLOSE, kernel, Point(-1,-1), 3);
+	morphologyEx(colorMask, mask, MORPH_CLOSE, kernel, Point(-1,-1), 3);
 	//imshow("Morphology", mask);
 
 	// edge detection
@@ -336,43 +344,347 @@ void detectTable(const Mat &frame, Vec<Point2f, 4> &corners, Vec2b &colorRange){
 	//imshow("Line", imgLine);
 }
 
+/**
+ * @brief Return the name of an algorithm used to find the circles of the balls.
+ * @param type type of the detector.
+ * @return the name of the detector.
+ */
+string ballDetectorName(BallDetectorType type) {
+	switch(type) {
+		case HOUGH_BALL_DETECTOR:
+			return "hough";
+		case GEOMETRIC_HOUGH_BALL_DETECTOR:
+			return "geometric-hough";
+		case RING_TEMPLATE_BALL_DETECTOR:
+			return "ring-template";
+	}
+	return "unknown";
+}
+
+/**
+ * @brief Return the algorithm used to find the circles of the balls with the given name.
+ * @param name name of the detector, as returned by ballDetectorName.
+ * @return the type of the detector.
+ * @throw invalid_argument if there is no detector with the given name.
+ */
+BallDetectorType ballDetectorFromName(const string &name) {
+	for(BallDetectorType type : {HOUGH_BALL_DETECTOR, GEOMETRIC_HOUGH_BALL_DETECTOR, RING_TEMPLATE_BALL_DETECTOR})
+		if(ballDetectorName(type) == name)
+			return type;
+	throw invalid_argument("Unknown ball detector " + name);
+}
+
+/**
+ * @brief Compute the bounds of the radius of the balls from the geometry of the table.
+ * The interval of radiusInterval, that follows the distance and the perspective of the table, is rounded outwards.
+ * It is a single interval for the whole table: the bounds do not vary with the position of the ball on the table.
+ * @param tableCorners corners of the table in the frame.
+ * @param minRadius output minimum radius.
+ * @param maxRadius output maximum radius.
+ */
+void houghRadiusBounds(const Vec<Point2f, 4> &tableCorners, int &minRadius, int &maxRadius) {
+	float minRadiusPx, maxRadiusPx;
+	radiusInterval(minRadiusPx, maxRadiusPx, tableCorners);
+	minRadius = max(1, cvFloor(minRadiusPx));
+	maxRadius = max(minRadius + 1, cvCeil(maxRadiusPx));
+}
+
+/**
+ * @brief Keep the strongest circles whose centers are farther than a minimum distance from each other.
+ * The candidates are sorted by decreasing score, then each of them is kept if its center is farther than the
+ * minimum distance from the centers of the already kept circles, as the Hough transform does for its circles.
+ * @param candidates circles with center, radius and score, they are sorted by decreasing score.
+ * @param circles output kept circles, sorted by decreasing score.
+ * @param minDistance minimum distance between the centers of two kept circles.
+ */
+void suppressCloseCircles(vector<Vec4f> &candidates, vector<Vec4f> &circles, float minDistance) {
+	sort(candidates.begin(), candidates.end(), [](const Vec4f &a, const Vec4f &b) { return a[3] > b[3]; });
+	circles.clear();
+	for(const Vec4f &candidate : candidates) {
+		bool suppressed = false;
+		for(const Vec4f &kept : circles)
+			if(norm(Point2f(kept[0], kept[1]) - Point2f(candidate[0], candidate[1])) < minDistance) {
+				suppressed = true;
+				break;
+			}
+		if(!suppressed)
+			circles.push_back(candidate);
+	}
+}
+
+/**
+ * @brief Find circles with a coarse Hough accumulator and refine each of them with a fine one.
+ * The coarse accumulator on the whole image finds the candidates; then the fine accumulator, at the resolution of
+ * the image, is computed only in a small region around each candidate, so the circles and their votes are the ones
+ * of the fine accumulator at a fraction of its cost. OpenCV raises an inverse resolution below 1 to 1, so the coarse
+ * accumulator is cheaper only with coarseAccumulatorResolution of at least 2. The candidates without a fine circle
+ * near them are discarded and the refined circles closer than the minimum distance are merged, keeping the one with
+ * more votes.
+ * @param gray input image, grayscale.
+ * @param circles output circles with center, radius and votes, sorted by decreasing votes.
+ * @param params parameters of the detection of the balls.
+ * @param minRadius minimum radius of the circles.
+ * @param maxRadius maximum radius of the circles.
+ */
+void houghCirclesCoarseToFine(const Mat &gray, vector<Vec4f> &circles, const BallDetectionParameters &params,
+							  int minRadius, int maxRadius) {
+	// inverse resolution of the refinement, the finest accepted by HoughCircles
+	const double FINE_ACCUMULATOR_RESOLUTION = 1;
+
+	vector<Vec4f> candidates, local, refined;
+	HoughCircles(gray, candidates, HOUGH_GRADIENT, params.coarseAccumulatorResolution, params.minDistance,
+				 params.houghParam1, params.houghParam2, minRadius, maxRadius);
+
+	const int half = maxRadius + params.refinementMargin;
+	const Rect image = Rect(0, 0, gray.cols, gray.rows);
+	for(const Vec4f &candidate : candidates) {
+		Point2f candidateCenter = Point2f(candidate[0], candidate[1]);
+		Rect window = Rect(cvRound(candidate[0]) - half, cvRound(candidate[1]) - half, 2 * half + 1, 2 * half + 1) & image;
+		HoughCircles(gray(window), local, HOUGH_GRADIENT, FINE_ACCUMULATOR_RESOLUTION, params.minDistance,
+					 params.houghParam1, params.houghParam2, minRadius, maxRadius);
+
+		// the fine circle nearest to the candidate
+		int best = -1;
+		double bestDistance = params.refinementMargin;
+		for(int i = 0; i < local.size(); i++) {
+			double distance = norm(Point2f(local[i][0] + window.x, local[i][1] + window.y) - candidateCenter);
+			if(distance <= bestDistance) {
+				best = i;
+				bestDistance = distance;
+			}
+		}
+		if(best >= 0)
+			refined.push_back(Vec4f(local[best][0] + window.x, local[best][1] + window.y, local[best][2], local[best][3]));
+	}
+
+	// two candidates can be refined to the same ball
+	suppressCloseCircles(refined, circles, params.minDistance);
+}
+
+/**
+ * @brief Partition a region in square tiles.
+ * @param region region to partition.
+ * @param tileSize side of the tiles, the tiles on the right and on the bottom can be smaller.
+ * @return the tiles, they do not overlap and they cover the region.
+ */
+vector<Rect> partitionTiles(const Rect &region, int tileSize) {
+	vector<Rect> tiles;
+	for(int y = region.y; y < region.br().y; y += tileSize)
+		for(int x = region.x; x < region.br().x; x += tileSize)
+			tiles.push_back(Rect(x, y, tileSize, tileSize) & region);
+	return tiles;
+}
+
+/**
+ * @brief Find the circles of the balls by correlating the gradient with a ring template.
+ * All the balls have almost the same radius, so the mean of the gradient magnitude on a ring of that radius is
+ * high only in the centers of the balls. The template has a Gaussian profile across the ring to tolerate the
+ * perspective and it is normalized to sum 1; the correlation is computed by filter2D, that uses the DFT for the
+ * large kernels. The table region is divided in tiles analyzed in parallel, each one with a margin as large as the
+ * template; then the local maxima above the threshold are kept, from the strongest, if they are farther than the
+ * minimum distance from the already kept ones.
+ * @param frame input image, BGR format requested.
+ * @param poly mask of the region where the centers are searched.
+ * @param circles output circles with center, radius and mean gradient, sorted by decreasing mean gradient.
+ * @param params parameters of the detection of the balls.
+ * @param radius expected radius of the balls.
+ */
+void ringTemplateCircles(const Mat &frame, const Mat &poly, vector<Vec4f> &circles,
+						 const BallDetectionParameters &params, float radius) {
+	circles.clear();
+	Rect region = boundingRect(poly);
+	if(region.empty())
+		return;
+
+	// ring template
+	const int half = cvCeil(radius + 3 * params.ringWidth);
+	Mat ring = Mat(2 * half + 1, 2 * half + 1, CV_32F);
+	for(int y = 0; y < ring.rows; y++)
+		for(int x = 0; x < ring.cols; x++) {
+			float d = norm(Point2f(x - half, y - half)) - radius;
+			ring.at<float>(y, x) = exp(-d * d / (2 * params.ringWidth * params.ringWidth));
+		}
+	ring /= sum(ring)[0];
+
+	// correlation in parallel tiles, each tile writes only its own region of the response
+	Mat response = Mat::zeros(frame.size(), CV_32F);
+	const int margin = half + 1;
+	const Rect image = Rect(0, 0, frame.cols, frame.rows);
+	vector<Rect> tiles = partitionTiles(region, max(cvRound(params.tileRadii * radius), 2 * margin));
+	parallel_for_(Range(0, tiles.size()), [&](const Range &range) {
+		Mat gray, gradientX, gradientY, magnitude, tileResponse;
+		for(int t = range.start; t < range.end; t++) {
+			Rect extended = Rect(tiles[t].x - margin, tiles[t].y - margin,
+								 tiles[t].width + 2 * margin, tiles[t].height + 2 * margin) & image;
+			cvtColor(frame(extended), gray, COLOR_BGR2GRAY);
+			// the scale brings the Sobel derivatives in gray levels per pixel
+			Sobel(gray, gradientX, CV_32F, 1, 0, 3, 0.25);
+			Sobel(gray, gradientY, CV_32F, 0, 1, 3, 0.25);
+			cv::magnitude(gradientX, gradientY, magnitude);
+			filter2D(magnitude, tileResponse, CV_32F, ring);
+			Rect inner = tiles[t] - extended.tl();
+			tileResponse(inner).copyTo(response(tiles[t]));
+		}
+	});
+
+	// non maxima suppression
+	Mat localMax;
+	dilate(response, localMax, getStructuringElement(MORPH_RECT, Size(3, 3)));
+	vector<Vec4f> candidates;
+	for(int y = region.y; y < region.br().y; y++) {
+		const float *r = response.ptr<float>(y);
+		const float *m = localMax.ptr<float>(y);
+		const uchar *p = poly.ptr<uchar>(y);
+		for(int x = region.x; x < region.br().x; x++)
+			if(p[x] == 255 && r[x] >= params.ringThreshold && r[x] >= m[x])
+				candidates.push_back(Vec4f(x, y, radius, r[x]));
+	}
+	suppressCloseCircles(candidates, circles, params.minDistance);
+}
+
+/**
+ * @brief Find the circles of the balls with the Hough detectors on overlapping tiles of the table in parallel.
+ * The bounding box of the table is divided in tiles of tileRadii expected radii. First the tiles are smoothed in
+ * parallel, each one extended by the radius of the bilateral filter, so the result is the one of the whole frame;
+ * then the smoothed table is masked and quantized with kmeans once, so all the tiles share the same colors. Finally
+ * each tile, extended by a margin that contains any ball centered in it, is searched for circles in parallel.
+ * A tile keeps only the circles centered in it and the circles of different tiles closer than the minimum distance
+ * are merged, keeping the one with more votes.
+ * @param frame input image, BGR format requested.
+ * @param poly mask of the region where the balls are searched.
+ * @param tableCorners corners of the table in the frame.
+ * @param clusterColors initial colors of the clustering.
+ * @param circles output circles with center, radius and votes, sorted by decreasing votes.
+ * @param params parameters of the detection of the balls.
+ */
+void tiledHoughCircles(const Mat &frame, const Mat &poly, const Vec<Point2f, 4> &tableCorners,
+					   const vector<Vec3b> &clusterColors, vector<Vec4f> &circles, const BallDetectionParameters &params) {
+	circles.clear();
+	Rect region = boundingRect(poly);
+	if(region.empty())
+		return;
+
+	int minRadius = params.minRadius, maxRadius = params.maxRadius;
+	if(params.detector == GEOMETRIC_HOUGH_BALL_DETECTOR)
+		houghRadiusBounds(tableCorners, minRadius, maxRadius);
+	float minRadiusPx, maxRadiusPx;
+	radiusInterval(minRadiusPx, maxRadiusPx, tableCorners);
+	// a ball centered in a tile and the circles near it are entirely in the extended tile
+	const int margin = maxRadius + params.minDistance;
+	const int tileSize = max(cvRound(params.tileRadii * (minRadiusPx + maxRadiusPx) / 2), 2 * margin);
+	const Rect image = Rect(0, 0, frame.cols, frame.rows);
+	vector<Rect> tiles = partitionTiles(region, tileSize);
+
+	// smoothing in parallel tiles, each tile writes only its own region of the smoothed table
+	Mat smooth = Mat(region.size(), CV_8UC3);
+	{
+		ScopedTimer bilateralTimer("detectBalls/bilateralFilter");
+		const int filterMargin = params.sizeBilateral / 2 + 1;
+		parallel_for_(Range(0, tiles.size()), [&](const Range &range) {
+			Mat tileSmooth;
+			for(int t = range.start; t < range.end; t++) {
+				Rect extended = Rect(tiles[t].x - filterMargin, tiles[t].y - filterMargin,
+									 tiles[t].width + 2 * filterMargin, tiles[t].height + 2 * filterMargin) & image;
+				bilateralFilter(frame(extended), tileSmooth, params.sizeBilateral, params.sigmaColor, params.sigmaSpace);
+				tileSmooth(tiles[t] - extended.tl()).copyTo(smooth(tiles[t] - region.tl()));
+			}
+		});
+	}
+
+	// one quantization for the whole table
+	Mat clustered, gray;
+	{
+		ScopedTimer clusteringTimer("detectBalls/kMeansClustering");
+		smooth.setTo(Scalar::all(0), poly(region) != 255);
+		kMeansClustering(smooth, clusterColors, clustered);
+		cvtColor(clustered, gray, COLOR_BGR2GRAY);
+	}
+
+	// Hough transform in parallel tiles, in the coordinates of the table region
+	vector<vector<Vec4f>> tileCircles(tiles.size());
+	{
+		ScopedTimer houghTimer("detectBalls/HoughCircles");
+		const Rect table = Rect(0, 0, region.width, region.height);
+		parallel_for_(Range(0, tiles.size()), [&](const Range &range) {
+			vector<Vec4f> found;
+			for(int t = range.start; t < range.end; t++) {
+				Rect tile = tiles[t] - region.tl();
+				Rect extended = Rect(tile.x - margin, tile.y - margin, tile.width + 2 * margin, tile.height + 2 * margin) & table;
+				if(params.detector == GEOMETRIC_HOUGH_BALL_DETECTOR)
+					houghCirclesCoarseToFine(gray(extended), found, params, minRadius, maxRadius);
+				else
+					HoughCircles(gray(extended), found, HOUGH_GRADIENT, params.inverseAccumulatorResolution, params.minDistance,
+								 params.houghParam1, params.houghParam2, minRadius, maxRadius);
+				for(const Vec4f &detected : found) {
+					Point2f center = Point2f(detected[0] + extended.x, detected[1] + extended.y);
+					if(tile.contains(Point(cvFloor(center.x), cvFloor(center.y))))
+						tileCircles[t].push_back(Vec4f(center.x + region.x, center.y + region.y, detected[2], detected[3]));
+				}
+			}
+		});
+	}
+
+	// de-duplication of the circles of neighboring tiles, as in a single Hough transform
+	vector<Vec4f> candidates;
+	for(const vector<Vec4f> &found : tileCircles)
+		candidates.insert(candidates.end(), found.begin(), found.end());
+	suppressCloseCircles(candidates, circles, params.minDistance);
+}
+
 /**
  * @brief detect balls in an image given some information about the table.
+ * The image is analyzed only for this detection, use the overload with the color analysis to share it.
+ * @param frame image where there are the balls to be detected, BGR format requested.
+ * @param table initialized object that contains the corner and the color, the balls are added in this function.
+ * @param params parameters of the detection.
+ * @throw invalid_argument if frame is empty or if frame has a number of channels different from 3.
+ */
+void detectBalls(const Mat &frame, Table &table, const DetectionParameters &params){
+	FrameColorAnalysis colors = FrameColorAnalysis(frame);
+	detectBalls(frame, colors, table, params);
+}
+
+/**
+ * @brief detect balls in an image given some information about the table, using the color analysis of the image.
  * In order to do this it exploits the information in the class table. Uses a bilateral filter to remove
  * noise but maintain the edges. Cluster the image using kmeans, another bilateral filter and then hough circles.
  * To isolate the good circles exploit the information of the table.
  * @param frame image where there are the balls to be detected, BGR format requested.
+ * @param colors color analysis of frame, shared with the other functions working on the same frame.
  * @param table initialized object that contains the corner and the color, the balls are added in this function.
- * @throw invalid_argument if frame is empty or if frame has a number of channels different from 3.
+ * @param params parameters of the detection.
+ * @throw invalid_argument if frame is empty or if frame has a number of channels different from 3
+ * 			or if colors is not the analysis of frame.
  */
-void detectBalls(const Mat &frame, Table &table){
+void detectBalls(const Mat &frame, FrameColorAnalysis &colors, Table &table, const DetectionParameters &params){
+	ScopedTimer timer("detectBalls");
 
 	if(frame.empty())
 		throw invalid_argument("Empty image in input");
 
 	if(frame.channels() != 3)
 		throw invalid_argument("Invalid number of channels for the input image");
+	colors.checkFrame(frame);
 
 	//table properties
 	const int NUMBER_CORNERS = 4;
-	Vec2b colorTable = table.getColorRange();
 	Vec<Point2f, NUMBER_CORNERS> tableCorners = table.getBoundaries();
 	Ptr<vector<Ball>> balls = table.ballsPtr();
 
-	// const used during the function
-	const int MIN_RADIUS = 6;
-	const int MAX_RADIUS = 14;
-	const int HOUGH_PARAM1 = 200;
-	const int HOUGH_PARAM2 = 8;
-	const float INVERSE_ACCUMULATOR_RESOLUTION = 0.1;
-	const int MIN_DISTANCE = 19;
-	const int SIZE_BILATERAL = 3;
-	const int SIGMA_COLOR = 15;
-	const int SIGMA_SPACE = 70;
-	const float RANGE_RADIUS = 0.3;
-	const int RADIUS_CORNERS = 20;
-
-	vector<Vec3b> colors = {
+	// parameters used during the function
+	const int MIN_RADIUS = params.balls.minRadius;
+	const int MAX_RADIUS = params.balls.maxRadius;
+	const int HOUGH_PARAM1 = params.balls.houghParam1;
+	const int HOUGH_PARAM2 = params.balls.houghParam2;
+	const float INVERSE_ACCUMULATOR_RESOLUTION = params.balls.inverseAccumulatorResolution;
+	const int MIN_DISTANCE = params.balls.minDistance;
+	const int SIZE_BILATERAL = params.balls.sizeBilateral;
+	const int SIGMA_COLOR = params.balls.sigmaColor;
+	const int SIGMA_SPACE = params.balls.sigmaSpace;
+	const float RANGE_RADIUS = params.balls.rangeRadius;
+	const int RADIUS_CORNERS = params.balls.radiusCorners;
+
+	vector<Vec3b> clusterColors = {
 		Vec3b(0, 0, 255),
 		Vec3b(0, 255, 0),
 		Vec3b(255, 0, 0),
@@ -381,22 +693,19 @@ void detectBalls(const Mat &frame, Table &table){
 	}; // needed as input for the clustering (5 colors with different gray level)
 
 	// variables
-	Mat gray, HSVImg, mask, smooth, kernelMorphological, resClustering, resClusteringSmooth;
+	Mat gray, mask, smooth, kernelMorphological, resClustering, resClusteringSmooth;
 	Mat poly = Mat::zeros(frame.size(), CV_8UC1);
-	vector<Vec3f> circles;
+	vector<Vec4f> circles; // center, radius and votes of the accumulator
 
 	//creation of the mask
-	cvtColor(frame, HSVImg, COLOR_BGR2HSV);
-	// imshow("HSV", HSVImg);
-	inRange(HSVImg, Scalar(colorTable[0], S_CHANNEL_COLOR_THRESHOLD, V_CHANNEL_COLOR_THRESHOLD),
-			Scalar(colorTable[1], 255, 255), mask);
-	kernelMorphological = getStructuringElement(MORPH_ELLIPSE, Size(2, 2));
-	morphologyEx(mask, mask, MORPH_DILATE, kernelMorphological);
-	//imshow("mask dilate", mask);
-
-	// smoothing
-	bilateralFilter(frame, smooth, SIZE_BILATERAL, SIGMA_COLOR, SIGMA_SPACE);
-	// imshow("smoothed", smooth);
+	{
+		ScopedTimer maskTimer("detectBalls/colorMask");
+		// imshow("HSV", colors.hsv());
+		const Mat &colorMask = colors.tableMask(table, params.saturationThreshold, params.valueThreshold);
+		kernelMorphological = getStructuringElement(MORPH_ELLIPSE, Size(2, 2));
+		morphologyEx(colorMask, mask, MORPH_DILATE, kernelMorphological);
+		//imshow("mask dilate", mask);
+	}
 
 	// poly to isolate the table
 	vector<Point> tableCornersInt;
@@ -409,24 +718,53 @@ void detectBalls(const Mat &frame, Table &table){
 	morphologyEx(poly, poly, MORPH_ERODE, kernelMorphological, Point(-1,-1), 7);
 	//imshow("Poly eroded", poly);
 
-	// mask the smooth image
-	for(int i = 0; i < poly.rows; i++)
-		for(int j = 0; j < poly.cols; j++)
-			if(poly.at<uchar>(i, j) != 255)
-				smooth.at<Vec3b>(i,j) = Vec3b(0, 0, 0);
-
-	// clustering
-	kMeansClustering(smooth, colors, resClustering);
-	cvtColor(resClustering, gray, COLOR_BGR2GRAY);
-	// imshow("Kmeans gray", gray);
-	// imshow("Kmeans", resClustering);
-
-	/*float minRadius, maxRadius;
-	radiusInterval(min_temp, max_temp, tableCorners);*/
+	if(params.balls.detector == RING_TEMPLATE_BALL_DETECTOR) {
+		// the ring template replaces smoothing, clustering and Hough transform
+		ScopedTimer ringTimer("detectBalls/ringTemplate");
+		float minRadius, maxRadius;
+		radiusInterval(minRadius, maxRadius, tableCorners);
+		ringTemplateCircles(frame, poly, circles, params.balls, max(1.0f, (minRadius + maxRadius) / 2));
+	} else if(params.balls.tiled) {
+		// smoothing, clustering and Hough transform on tiles of the table in parallel
+		ScopedTimer tiledTimer("detectBalls/tiledHough");
+		tiledHoughCircles(frame, poly, tableCorners, clusterColors, circles, params.balls);
+	} else {
+		// smoothing
+		{
+			ScopedTimer bilateralTimer("detectBalls/bilateralFilter");
+			bilateralFilter(frame, smooth, SIZE_BILATERAL, SIGMA_COLOR, SIGMA_SPACE);
+			// imshow("smoothed", smooth);
+		}
 
-	// Hough transform
-	HoughCircles(gray, circles, HOUGH_GRADIENT, INVERSE_ACCUMULATOR_RESOLUTION,
-					MIN_DISTANCE, HOUGH_PARAM1, HOUGH_PARAM2, MIN_RADIUS, MAX_RADIUS);
+		// mask the smooth image
+		for(int i = 0; i < poly.rows; i++)
+			for(int j = 0; j < poly.cols; j++)
+				if(poly.at<uchar>(i, j) != 255)
+					smooth.at<Vec3b>(i,j) = Vec3b(0, 0, 0);
+
+		// clustering
+		{
+			ScopedTimer clusteringTimer("detectBalls/kMeansClustering");
+			kMeansClustering(smooth, clusterColors, resClustering);
+			cvtColor(resClustering, gray, COLOR_BGR2GRAY);
+		}
+		// imshow("Kmeans gray", gray);
+		// imshow("Kmeans", resClustering);
+
+		// Hough transform, the votes are used as confidence of the detections
+		{
+			ScopedTimer houghTimer("detectBalls/HoughCircles");
+			if(params.balls.detector == GEOMETRIC_HOUGH_BALL_DETECTOR) {
+				// the radius bounds follow the size and the perspective of the table
+				int minRadius, maxRadius;
+				houghRadiusBounds(tableCorners, minRadius, maxRadius);
+				houghCirclesCoarseToFine(gray, circles, params.balls, minRadius, maxRadius);
+			} else {
+				HoughCircles(gray, circles, HOUGH_GRADIENT, INVERSE_ACCUMULATOR_RESOLUTION,
+								MIN_DISTANCE, HOUGH_PARAM1, HOUGH_PARAM2, MIN_RADIUS, MAX_RADIUS);
+			}
+		}
+	}
 
 	// compute the mean of good circles
 	Category category;
@@ -439,7 +777,7 @@ void detectBalls(const Mat &frame, Table &table){
 	double meanRadius = 0;
 	int counter = 0;
 	for(size_t i = 0; i < circles.size(); i++ ){
-		c = circles[i];
+		c = Vec3f(circles[i][0], circles[i][1], circles[i][2]);
 	 	center = Point(c[0], c[1]);
 	 	radius = c[2];
 		// inside the table and with a color different from the table color
@@ -456,8 +794,9 @@ void detectBalls(const Mat &frame, Table &table){
 	}
 	meanRadius /= counter;
 
+	ScopedTimer classificationTimer("detectBalls/classification");
 	for(size_t i = 0; i < circles.size(); i++ ){
-		c = circles[i];
+		c = Vec3f(circles[i][0], circles[i][1], circles[i][2]);
 	 	center = Point(c[0], c[1]);
 	 	radius = c[2];
 		// inside the table and with a color different from the table color, not too big and not too small
@@ -471,11 +810,14 @@ void detectBalls(const Mat &frame, Table &table){
 
 			rect = Rect(center.x-c[2], center.y-c[2], 2*c[2], 2*c[2]);
 			subImg = frame(rect);
-			category = classificationBall(subImg, radius);
-			if(category != BACKGROUND)
-				balls->push_back(Ball(rect, category));
+			category = classificationBall(subImg, radius, params.classification);
+			if(category != BACKGROUND){
+				Ball ball = Ball(rect, category);
+				ball.setConfidence(circles[i][3]);
+				balls->push_back(ball);
+			}
 		}
 	}
 
-	nonMaximaSuppressionWhiteBlack(HSVImg, balls);
+	nonMaximaSuppressionWhiteBlack(colors.hsv(), balls);
 }
@@ -0,0 +1,251 @@
+// Author: Alberto Pasqualetto
+
+#include "evaluation.h"
+
+#include <stdexcept>
+#include <functional>
+#include <opencv2/core.hpp>
+#include "table.h"
+#include "detection.h"
+#include "segmentation.h"
+#include "groundTruth.h"
+#include "frameAccess.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ * @brief Constructor of an empty result.
+ */
+EvaluationResult::EvaluationResult() {
+	confusion_ = ConfusionMatrix::zeros();
+	for (int c = 0; c < NUMBER_BALL_CATEGORIES; c++)
+		groundTruthCount_[c] = 0;
+	frames_ = 0;
+}
+
+/**
+ * @brief Add the evaluation of a frame.
+ * The detections are matched with the ground truth of the same frame, the matches are kept to compute the AP on
+ * all the frames; the confusion matrix of the segmentation is summed to the accumulated one.
+ * @param detectedBalls vector of detected balls.
+ * @param groundTruthBboxes vector of pairs of (Rect, Category) that represent the ground truth bounding boxes.
+ * @param segmentedImage segmented image.
+ * @param groundTruthMask ground truth mask.
+ * @param iouThreshold Intersection over Union threshold for the detection.
+ * @throw invalid_argument if detectedBalls is nullptr or if the segmentation cannot be compared with the mask.
+ */
+void EvaluationResult::addFrame(Ptr<vector<Ball>> detectedBalls, const vector<pair<Rect, Category>> &groundTruthBboxes,
+								const Mat &segmentedImage, const Mat &groundTruthMask, float iouThreshold /*= MAP_IOU_THRESHOLD*/) {
+	if (detectedBalls == nullptr)
+		throw invalid_argument("Null detectedBalls");
+
+	for (Category cat = Category::WHITE_BALL; cat <= Category::STRIPED_BALL; cat = static_cast<Category>(cat + 1)) {
+		matchDetections(*detectedBalls, groundTruthBboxes, cat, iouThreshold, matches_[cat - 1], groundTruthCount_[cat - 1]);
+	}
+
+	confusion_ += segmentationConfusionMatrix(segmentedImage, groundTruthMask);
+	frames_++;
+}
+
+/**
+ * @brief Merge another partial result in this one.
+ * @param other partial result to merge.
+ */
+void EvaluationResult::merge(const EvaluationResult &other) {
+	confusion_ += other.confusion_;
+	for (int c = 0; c < NUMBER_BALL_CATEGORIES; c++) {
+		matches_[c].insert(matches_[c].end(), other.matches_[c].begin(), other.matches_[c].end());
+		groundTruthCount_[c] += other.groundTruthCount_[c];
+	}
+	frames_ += other.frames_;
+}
+
+/**
+ * @brief Return the Average Precision of a ball category.
+ * @param cat Category of balls.
+ * @return double AP value.
+ * @throw invalid_argument if cat is not a ball category.
+ */
+double EvaluationResult::AP(Category cat) const {
+	if (cat < Category::WHITE_BALL || cat > Category::STRIPED_BALL)
+		throw invalid_argument("Category is not a ball category");
+
+	return averagePrecision(matches_[cat - 1], groundTruthCount_[cat - 1]);
+}
+
+/**
+ * @brief Return the mean Average Precision over the ball categories.
+ * @return double mAP value.
+ */
+double EvaluationResult::mAP() const {
+	double sum = 0;
+	for (Category cat = Category::WHITE_BALL; cat <= Category::STRIPED_BALL; cat = static_cast<Category>(cat + 1)) {
+		sum += AP(cat);
+	}
+	return sum / NUMBER_BALL_CATEGORIES;
+}
+
+/**
+ * @brief Return the Intersection over Union of each category.
+ * @return std::vector<double> vector of IoU values for each category.
+ */
+vector<double> EvaluationResult::IoUs() const {
+	return IoUFromConfusionMatrix(confusion_);
+}
+
+/**
+ * @brief Return the mean Intersection over Union over the categories.
+ * @return double mIoU value.
+ */
+double EvaluationResult::mIoU() const {
+	vector<double> IoUs = this->IoUs();
+	double sum = 0;
+	for (double iou : IoUs)
+		sum += iou;
+	return sum / IoUs.size();
+}
+
+/**
+ * @brief Return the number of evaluated frames.
+ * @return the number of frames.
+ */
+int EvaluationResult::getFrames() const {
+	return frames_;
+}
+
+/**
+ * @brief Detect and segment the balls in a frame and add the evaluation to the result.
+ * @param frame frame to evaluate.
+ * @param colors color analysis of frame.
+ * @param table table with the corners and the color already detected, the balls are replaced.
+ * @param clipPath path to the folder of the clip in the dataset.
+ * @param frameN Set to FIRST for the first frame, LAST for the last frame.
+ * @param params parameters of the detection.
+ * @param result result where the evaluation of the frame is added.
+ */
+void evaluateFrame(const Mat &frame, FrameColorAnalysis &colors, Table &table, const string &clipPath, FrameN frameN,
+				   const DetectionParameters &params, EvaluationResult &result) {
+	Mat segmented;
+	table.clearBalls();
+	detectBalls(frame, colors, table, params);
+	segmentTable(frame, colors, table, segmented);
+	segmentBalls(segmented, table.ballsPtr(), segmented);
+
+	const GroundTruthFrame &groundTruth = GroundTruthStore::instance().get(clipPath, frameN);
+	result.addFrame(table.ballsPtr(), groundTruth.bboxes, segmented, groundTruth.mask);
+}
+
+/**
+ * @brief Decode the first and the last frame of a clip.
+ * The frames are taken from the shared frame store, so each video is decoded at most once and only the two
+ * frames are read.
+ * @param clipPath path to the folder of the clip in the dataset.
+ * @return the decoded frames of the clip.
+ * @throw invalid_argument if the video of the clip cannot be read.
+ */
+ClipFrames loadClipFrames(const string &clipPath) {
+	ClipFrames frames;
+	frames.clipPath = clipPath;
+	frames.first = FrameStore::instance().get(clipPath, FIRST);
+	frames.last = FrameStore::instance().get(clipPath, LAST);
+	return frames;
+}
+
+/**
+ * @brief Evaluate the detection and the segmentation in the first and the last frame of a clip.
+ * The table is detected in the first frame and used for both the frames.
+ * @param frames decoded frames of the clip.
+ * @param params parameters of the detection.
+ * @return the result of the evaluation of the clip.
+ * @throw runtime_error if the table cannot be detected.
+ */
+EvaluationResult evaluateClip(const ClipFrames &frames, const DetectionParameters &params /*= DetectionParameters()*/) {
+	EvaluationResult result;
+	Vec<Point2f, 4> tableCorners;
+	Vec2b colorTable;
+	// each frame is converted to HSV once, for the detection of the table, of the balls and the segmentation
+	FrameColorAnalysis colors = FrameColorAnalysis(frames.first);
+	detectTable(frames.first, colors, tableCorners, colorTable, params);
+	Table table = Table(tableCorners, colorTable);
+	evaluateFrame(frames.first, colors, table, frames.clipPath, FIRST, params, result);
+	colors.analyze(frames.last);
+	evaluateFrame(frames.last, colors, table, frames.clipPath, LAST, params, result);
+	return result;
+}
+
+/**
+ * @brief Evaluate the detection and the segmentation in the first and the last frame of a clip.
+ * @param clipPath path to the folder of the clip in the dataset.
+ * @return the result of the evaluation of the clip.
+ * @throw invalid_argument if the video of the clip cannot be read.
+ */
+EvaluationResult evaluateClip(const string &clipPath) {
+	return evaluateClip(loadClipFrames(clipPath));
+}
+
+/**
+ * @brief Evaluate clips in parallel with a given evaluation.
+ * Each clip is evaluated independently in its own slot, then all the partial results are merged.
+ * @param clipPaths paths to the folders of the clips, used in the error messages.
+ * @param evaluate evaluation of the clip with the given index.
+ * @param clipResults output vector containing the result of each clip, in the same order of clipPaths.
+ * @return the result of all the clips.
+ * @throw runtime_error if the evaluation of a clip fails.
+ */
+EvaluationResult evaluateInParallel(const vector<string> &clipPaths, const function<EvaluationResult(int)> &evaluate,
+									vector<EvaluationResult> &clipResults) {
+	clipResults.assign(clipPaths.size(), EvaluationResult());
+	vector<string> errors(clipPaths.size());
+
+	parallel_for_(Range(0, clipPaths.size()), [&](const Range &range) {
+		for (int i = range.start; i < range.end; i++) {
+			try {
+				clipResults[i] = evaluate(i);
+			} catch (const exception &e) {
+				errors[i] = e.what();
+			}
+		}
+	});
+
+	EvaluationResult result;
+	for (int i = 0; i < clipPaths.size(); i++) {
+		if (!errors[i].empty())
+			throw runtime_error("Evaluation of " + clipPaths[i] + " failed: " + errors[i]);
+		result.merge(clipResults[i]);
+	}
+	return result;
+}
+
+/**
+ * @brief Evaluate all the clips in parallel.
+ * Each clip is decoded and evaluated independently in its own slot, then all the partial results are merged.
+ * @param clipPaths paths to the folders of the clips in the dataset.
+ * @param clipResults output vector containing the result of each clip, in the same order of clipPaths.
+ * @return the result of the whole dataset.
+ * @throw runtime_error if the evaluation of a clip fails.
+ */
+EvaluationResult evaluateDataset(const vector<string> &clipPaths, vector<EvaluationResult> &clipResults) {
+	return evaluateInParallel(clipPaths, [&](int i) {
+		return evaluateClip(clipPaths[i]);
+	}, clipResults);
+}
+
+/**
+ * @brief Evaluate all the already decoded clips in parallel with the given parameters.
+ * The frames are only read, so the same clips can be evaluated many times with different parameters.
+ * @param clips decoded frames of the clips.
+ * @param params parameters of the detection.
+ * @param clipResults output vector containing the result of each clip, in the same order of clips.
+ * @return the result of the whole dataset.
+ * @throw runtime_error if the evaluation of a clip fails.
+ */
+EvaluationResult evaluateDataset(const vector<ClipFrames> &clips, const DetectionParameters &params,
+								 vector<EvaluationResult> &clipResults) {
+	vector<string> clipPaths;
+	for (const ClipFrames &clip : clips)
+		clipPaths.push_back(clip.clipPath);
+	return evaluateInParallel(clipPaths, [&](int i) {
+		return evaluateClip(clips[i], params);
+	}, clipResults);
+}
@@ -0,0 +1,238 @@
+// Author: Michela Schibuola
+
+#include "events.h"
+
+#include <stdexcept>
+#include <fstream>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+#include "constants.h"
+
+using namespace cv;
+using namespace std;
+
+/**
+ * @brief Constructor.
+ * The pocket zones are circles of diameter POCKET_DIAMETER_CM centered in the pockets of the minimap, they are
+ * brought in the frame coordinates by using the inverse of the transformation matrix.
+ * @param balls pointer to the vector of balls.
+ * @param transform transformation matrix from the frame to the minimap.
+ * @param fps frame rate of the video.
+ * @throw invalid_argument if balls is nullptr, if the transform is empty or if fps is not positive.
+ */
+EventDetector::EventDetector(Ptr<vector<Ball>> balls, const Mat &transform, double fps) { // NOLINT(*-unnecessary-value-param)
+	reset(balls, transform, fps);
+}
+
+/**
+ * @brief Start detecting the events of a new clip, the buffers of the previous one are reused.
+ * The state of the balls and the stream of the events are cleared and the pocket zones are computed again.
+ * @param balls pointer to the vector of balls.
+ * @param transform transformation matrix from the frame to the minimap.
+ * @param fps frame rate of the video.
+ * @throw invalid_argument if balls is nullptr, if the transform is empty or if fps is not positive.
+ */
+void EventDetector::reset(Ptr<vector<Ball>> balls, const Mat &transform, double fps) { // NOLINT(*-unnecessary-value-param)
+	if(balls == nullptr)
+		throw invalid_argument("Null pointer");
+
+	if(transform.empty())
+		throw invalid_argument("Empty transformation matrix in input");
+
+	if(fps <= 0)
+		throw invalid_argument("Frame rate negative or equal to zero");
+
+	balls_ = balls;
+	fps_ = fps;
+	restFrames_ = 0;
+
+	const size_t n = balls_->size();
+	positions_.resize(n);
+	velocities_.assign(n, Point2f(0, 0));
+	hasPosition_.assign(n, false);
+	scored_.assign(n, false);
+	lastCollisionFrame_.assign(n * n, -1);
+	events_.clear();
+
+	//pocket zones in the frame coordinates
+	const int ZONE_POINTS = 16;
+	Mat inverse = transform.inv();
+	pocketZones_.resize(NUMBER_POCKETS);
+	vector<Point2f> mapZone (ZONE_POINTS);
+	for(int k = 0; k < NUMBER_POCKETS; k++) {
+		for(int p = 0; p < ZONE_POINTS; p++) {
+			double angle = 2 * CV_PI * p / ZONE_POINTS;
+			mapZone[p] = MAP_POCKETS[k] + Point2f(MAP_POCKET_RADIUS * cos(angle), MAP_POCKET_RADIUS * sin(angle));
+		}
+		perspectiveTransform(mapZone, pocketZones_[k], inverse);
+	}
+}
+
+/**
+ * @brief Create an event and add it to the stream.
+ * @param type type of the event.
+ * @param frame number of the frame of the event.
+ * @param ballIndex index of the ball.
+ * @param otherBallIndex index of the other ball, -1 if not needed.
+ * @param pocketIndex index of the pocket, -1 if not needed.
+ */
+void EventDetector::addEvent(EventType type, int frame, int ballIndex, int otherBallIndex /*= -1*/, int pocketIndex /*= -1*/) {
+	PoolEvent event;
+	event.type = type;
+	event.frame = frame;
+	event.timestamp = (frame - 1) / fps_;
+	event.ballIndex = ballIndex;
+	event.otherBallIndex = otherBallIndex;
+	event.pocketIndex = pocketIndex;
+	event.position = positions_[ballIndex];
+	events_.push_back(event);
+}
+
+/**
+ * @brief Update the state of the balls and detect the events of the current frame.
+ * The velocity of each ball is the difference between its positions in two consecutive frames, converted in cm/s
+ * and smoothed with an exponential moving average. A ball is scored when it enters a pocket region; two balls
+ * collide when they are in contact and at least one of them has a sudden change of velocity; the cue ball is
+ * struck when it starts moving after being at rest for some frames.
+ * @param frame number of the current frame, starting from 1.
+ * @param positions positions of the balls in the minimap in the current frame.
+ * @return number of events detected in the current frame.
+ */
+int EventDetector::update(int frame, const MinimapPositions &positions) {
+	// const used to detect the events
+	const float VELOCITY_SMOOTHING = 0.5;
+	const float REST_SPEED = 5;				// cm/s
+	const float STRIKE_SPEED = 30;			// cm/s
+	const float COLLISION_DELTA_SPEED = 20;	// cm/s
+	const float COLLISION_DISTANCE = 3 * MAP_BALL_RADIUS;	// minimap pixels, tolerance for the tracking error
+	const int MIN_REST_FRAMES = 10;
+	const int COLLISION_COOLDOWN_FRAMES = static_cast<int>(fps_ / 2);
+
+	const size_t n = balls_->size();
+	const size_t eventsBefore = events_.size();
+	vector<bool> active (n, false);
+	vector<float> deltaSpeed (n, 0);
+
+	//update positions and velocities, detect scored balls
+	for(size_t i = 0; i < n; i++) {
+		if(scored_[i])
+			continue;
+
+		if(positions.currentRegion[i] == POCKET_REGION) {
+			int nearest = 0;
+			for(int k = 1; k < NUMBER_POCKETS; k++)
+				if(norm(positions.current[i] - MAP_POCKETS[k]) < norm(positions.current[i] - MAP_POCKETS[nearest]))
+					nearest = k;
+			positions_[i] = positions.current[i];
+			scored_[i] = true;
+			addEvent(POT_EVENT, frame, i, -1, nearest);
+			continue;
+		}
+
+		if(positions.currentRegion[i] != PLAYING_FIELD_REGION || !(balls_->at(i)).getVisibility())
+			continue;
+
+		if(hasPosition_[i]) {
+			Point2f rawVelocity = (positions.current[i] - positions_[i]) * (fps_ * MAP_PX_TO_CM);
+			Point2f velocity = VELOCITY_SMOOTHING * rawVelocity + (1 - VELOCITY_SMOOTHING) * velocities_[i];
+			deltaSpeed[i] = norm(velocity - velocities_[i]);
+			velocities_[i] = velocity;
+		}
+		positions_[i] = positions.current[i];
+		hasPosition_[i] = true;
+		active[i] = true;
+	}
+
+	//collisions between balls in contact with a sudden change of velocity
+	for(size_t i = 0; i < n; i++) {
+		for(size_t j = i + 1; j < n; j++) {
+			if(!active[i] || !active[j])
+				continue;
+			if(norm(positions_[i] - positions_[j]) > COLLISION_DISTANCE)
+				continue;
+			if(deltaSpeed[i] < COLLISION_DELTA_SPEED && deltaSpeed[j] < COLLISION_DELTA_SPEED)
+				continue;
+			int &lastCollision = lastCollisionFrame_[i * n + j];
+			if(lastCollision != -1 && frame - lastCollision < COLLISION_COOLDOWN_FRAMES)
+				continue;
+			lastCollision = frame;
+			if(deltaSpeed[i] >= deltaSpeed[j])
+				addEvent(COLLISION_EVENT, frame, i, j);
+			else
+				addEvent(COLLISION_EVENT, frame, j, i);
+		}
+	}
+
+	//strike of the cue ball
+	for(size_t i = 0; i < n; i++) {
+		if(!active[i] || (balls_->at(i)).getCategory() != WHITE_BALL)
+			continue;
+		float speed = norm(velocities_[i]);
+		if(speed < REST_SPEED) {
+			restFrames_++;
+		}
+		else {
+			if(speed > STRIKE_SPEED && restFrames_ >= MIN_REST_FRAMES)
+				addEvent(CUE_STRIKE_EVENT, frame, i);
+			restFrames_ = 0;
+		}
+	}
+
+	return events_.size() - eventsBefore;
+}
+
+/**
+ * @brief Return the pocket zones in the frame coordinates.
+ * @return a vector of polygons, one for each pocket in the same order of MAP_POCKETS.
+ */
+const vector<vector<Point2f>> &EventDetector::getPocketZones() const {
+	return pocketZones_;
+}
+
+/**
+ * @brief Return the stream of the detected events.
+ * @return the events ordered by frame.
+ */
+const vector<PoolEvent> &EventDetector::getEvents() const {
+	return events_;
+}
+
+/**
+ * @brief Write the stream of the events in a CSV file.
+ * One line for each event with frame, timestamp, type, balls involved, pocket and position in the minimap.
+ * @param path path of the output file.
+ * @throw runtime_error if the file cannot be opened.
+ */
+void EventDetector::writeEvents(const string &path) const {
+	ofstream file(path);
+	if(!file.is_open())
+		throw runtime_error("Cannot open the events file");
+
+	file << "frame,timestamp,event,ball,category,other_ball,pocket,x,y" << endl;
+	for(const PoolEvent &event : events_) {
+		file << event.frame << ","
+			<< event.timestamp << ","
+			<< eventTypeName(event.type) << ","
+			<< event.ballIndex << ","
+			<< (balls_->at(event.ballIndex)).getCategory() << ","
+			<< event.otherBallIndex << ","
+			<< event.pocketIndex << ","
+			<< event.position.x << ","
+			<< event.position.y << endl;
+	}
+}
+
+/**
+ * @brief Return a readable name of the event type.
+ * @param type type of the event.
+ * @return the name of the event type.
+ */
+string eventTypeName(EventType type) {
+	switch(type) {
+		case POT_EVENT: return "pot";
+		case COLLISION_EVENT: return "collision";
+		case CUE_STRIKE_EVENT: return "cue_strike";
+		default:
+			throw invalid_argument("Not correct event type");
+	}
+}
@@ -0,0 +1,305 @@
+// Author: Michele Sprocatti
+
+#include "frameAccess.h"
+
+#include <stdexcept>
+#include <filesystem>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <opencv2/core.hpp>
+
+using namespace std;
+using namespace cv;
+
+// layout of the binary cache: header, then the raw pixels of the two frames aligned to 64 bytes
+const uint32_t FRAME_CACHE_MAGIC = 0x46504238;	// "8BPF"
+const uint32_t FRAME_CACHE_VERSION = 1;
+const size_t FRAME_CACHE_ALIGNMENT = 64;
+
+/**
+ * Header of the binary cache of the frames.
+ */
+struct FrameCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	int32_t rows;
+	int32_t cols;
+	int32_t type;
+};
+
+/**
+ * @brief Constructor.
+ * @param videoPath path of the video.
+ * @throw invalid_argument if the video cannot be opened.
+ */
+FrameReader::FrameReader(const string &videoPath) {
+	videoPath_ = videoPath;
+	video_ = VideoCapture(videoPath);
+	if (!video_.isOpened())
+		throw invalid_argument("Error opening video file " + videoPath);
+	position_ = 0;
+	frameCount_ = -1;
+}
+
+/**
+ * @brief Reopen the video and grab the frames until the requested one, then read it.
+ * @param index index of the frame, starting from 0.
+ * @param frame output frame.
+ * @return true if the frame has been read.
+ */
+bool FrameReader::readSequential(int index, Mat &frame) {
+	video_.open(videoPath_);
+	position_ = 0;
+	while (position_ < index && video_.grab())
+		position_++;
+	if (position_ < index || !video_.read(frame))
+		return false;
+	position_++;
+	return true;
+}
+
+/**
+ * @brief Return the exact number of frames of the video.
+ * The number stored in the container is not always reliable, so the first call counts the frames by grabbing them,
+ * without converting or copying them.
+ * @return the number of frames.
+ */
+int FrameReader::getFrameCount() {
+	if (frameCount_ < 0) {
+		video_.open(videoPath_);
+		frameCount_ = 0;
+		while (video_.grab())
+			frameCount_++;
+		video_.open(videoPath_);
+		position_ = 0;
+	}
+	return frameCount_;
+}
+
+/**
+ * @brief Read a frame of the video.
+ * If the frame is the next one it is simply decoded, otherwise the decoder seeks to it and the position after the
+ * read is checked. If the check fails the frame is reached sequentially.
+ * @param index index of the frame, starting from 0.
+ * @param frame output frame.
+ * @return true if the frame has been read, false if it does not exist.
+ */
+bool FrameReader::read(int index, Mat &frame) {
+	if (index < 0 || (frameCount_ >= 0 && index >= frameCount_))
+		return false;
+
+	if (index != position_) {
+		if (video_.set(CAP_PROP_POS_FRAMES, index) && video_.read(frame)
+			&& static_cast<int>(video_.get(CAP_PROP_POS_FRAMES)) == index + 1) {
+			position_ = index + 1;
+			return true;
+		}
+		return readSequential(index, frame);
+	}
+
+	if (!video_.read(frame))
+		return false;
+	position_++;
+	return true;
+}
+
+/**
+ * @brief Read the last frame of the video.
+ * The frame count stored in the container is tried first: the frame is the last one if it can be read and no other
+ * frame follows it. Otherwise the frames are counted and the exact last frame is read.
+ * @param frame output frame.
+ * @return true if the frame has been read, false if the video is empty.
+ */
+bool FrameReader::readLast(Mat &frame) {
+	if (frameCount_ < 0) {
+		int declaredCount = static_cast<int>(video_.get(CAP_PROP_FRAME_COUNT));
+		if (declaredCount > 0 && read(declaredCount - 1, frame)) {
+			if (!video_.grab()) {
+				frameCount_ = declaredCount;
+				return true;
+			}
+			position_++;
+		}
+	}
+
+	int frameCount = getFrameCount();
+	if (frameCount == 0)
+		return false;
+	return read(frameCount - 1, frame);
+}
+
+/**
+ * @brief Compute the offsets of the frames in the cache.
+ * @param header header of the cache.
+ * @param frameOffsets output offsets of the two frames.
+ * @return the total size of the cache.
+ */
+size_t frameCacheLayout(const FrameCacheHeader &header, size_t frameOffsets[2]) {
+	size_t frameSize = static_cast<size_t>(header.rows) * header.cols * CV_ELEM_SIZE(header.type);
+	size_t offset = sizeof(FrameCacheHeader);
+	for (int f = 0; f < 2; f++) {
+		offset = (offset + FRAME_CACHE_ALIGNMENT - 1) / FRAME_CACHE_ALIGNMENT * FRAME_CACHE_ALIGNMENT;
+		frameOffsets[f] = offset;
+		offset += frameSize;
+	}
+	return offset;
+}
+
+/**
+ * @brief Write the first and the last frame of a clip in the binary cache.
+ * @param path path of the cache.
+ * @param frames first and last frame, with the same size and type.
+ * @return true if the cache has been written, false otherwise.
+ */
+bool writeFrameCache(const string &path, const Mat frames[2]) {
+	if (frames[0].size() != frames[1].size() || frames[0].type() != frames[1].type())
+		return false;
+
+	FrameCacheHeader header;
+	header.magic = FRAME_CACHE_MAGIC;
+	header.version = FRAME_CACHE_VERSION;
+	header.rows = frames[0].rows;
+	header.cols = frames[0].cols;
+	header.type = frames[0].type();
+	size_t frameOffsets[2];
+	size_t size = frameCacheLayout(header, frameOffsets);
+
+	vector<unsigned char> content(size, 0);
+	memcpy(content.data(), &header, sizeof(FrameCacheHeader));
+	size_t rowSize = static_cast<size_t>(header.cols) * frames[0].elemSize();
+	for (int f = 0; f < 2; f++)
+		for (int i = 0; i < header.rows; i++)
+			memcpy(content.data() + frameOffsets[f] + i * rowSize, frames[f].ptr(i), rowSize);
+
+	// write to a temporary file first, then rename it, so a partially written cache is never read
+	string temporaryPath = path + ".tmp";
+	{
+		ofstream file(temporaryPath, ios::binary);
+		if (!file.is_open())
+			return false;
+		file.write(reinterpret_cast<const char *>(content.data()), content.size());
+		if (!file.good())
+			return false;
+	}
+	error_code error;
+	filesystem::rename(temporaryPath, path, error);
+	return !error;
+}
+
+/**
+ * @brief Read the first and the last frame of a clip from the binary cache.
+ * The frames are not copied: they point to the memory of the mapped cache.
+ * @param path path of the cache.
+ * @param cache output mapped cache, it owns the memory of the frames.
+ * @param frames output first and last frame.
+ * @return true if the cache is valid and has been read, false otherwise.
+ */
+bool readFrameCache(const string &path, Ptr<MappedFile> &cache, Mat frames[2]) {
+	try {
+		cache = makePtr<MappedFile>(path);
+	} catch (const runtime_error &) {
+		return false;
+	}
+
+	if (cache->size() < sizeof(FrameCacheHeader))
+		return false;
+
+	FrameCacheHeader header;
+	memcpy(&header, cache->data(), sizeof(FrameCacheHeader));
+	if (header.magic != FRAME_CACHE_MAGIC || header.version != FRAME_CACHE_VERSION
+		|| header.rows <= 0 || header.cols <= 0 || header.type != CV_8UC3)
+		return false;
+
+	size_t frameOffsets[2];
+	if (frameCacheLayout(header, frameOffsets) > cache->size())
+		return false;
+
+	for (int f = 0; f < 2; f++)
+		frames[f] = Mat(header.rows, header.cols, header.type, cache->data() + frameOffsets[f]);
+	return true;
+}
+
+/**
+ * @brief Return the store shared by the whole program.
+ * @return the store.
+ */
+FrameStore &FrameStore::instance() {
+	static FrameStore store;
+	return store;
+}
+
+/**
+ * @brief Load the frames of a clip from the cache or from the video.
+ * The cache is used only if it is newer than the video, otherwise the two frames are decoded with random access
+ * and the cache is rebuilt. If the cache cannot be written the frames are kept only in memory.
+ * @param clipPath path to the folder of the clip.
+ * @return the frames of the clip.
+ * @throw invalid_argument if the video cannot be read.
+ */
+FrameStore::ClipFrames FrameStore::loadClip(const string &clipPath) {
+	filesystem::path folder = filesystem::path(clipPath);
+	filesystem::path videoPath = folder / (folder.filename().string() + ".mp4");
+	filesystem::path cachePath = folder / DECODED_FRAMES_CACHE_NAME;
+
+	ClipFrames clip;
+
+	// use the cache only if it is up to date
+	error_code error;
+	bool cacheValid = filesystem::exists(cachePath, error) && filesystem::exists(videoPath, error)
+					  && filesystem::last_write_time(videoPath) <= filesystem::last_write_time(cachePath);
+	if (cacheValid && readFrameCache(cachePath.string(), clip.cache, clip.frames))
+		return clip;
+
+	clip.cache.release();
+	FrameReader reader = FrameReader(videoPath.string());
+	if (!reader.read(0, clip.frames[0]) || !reader.readLast(clip.frames[1]))
+		throw invalid_argument("Error reading video file " + videoPath.string());
+
+	writeFrameCache(cachePath.string(), clip.frames);
+	return clip;
+}
+
+/**
+ * @brief Return a frame of a clip, loading it if needed.
+ * @param clipPath path to the folder of the clip.
+ * @param frameN Set to FIRST for the first frame, LAST for the last frame.
+ * @return the frame in BGR format, valid until the store is cleared. It must not be modified.
+ * @throw invalid_argument if frameN is not FIRST or LAST or if the video cannot be read.
+ */
+const Mat &FrameStore::get(const string &clipPath, FrameN frameN) {
+	int index;
+	switch (frameN) {
+		case FIRST:
+			index = 0;
+			break;
+		case LAST:
+			index = 1;
+			break;
+		default:
+			throw invalid_argument("frameN must be FIRST or LAST");
+	}
+
+	string key = filesystem::path(clipPath).lexically_normal().string();
+	{
+		lock_guard<mutex> lock(mutex_);
+		map<string, ClipFrames>::iterator it = clips_.find(key);
+		if (it != clips_.end())
+			return it->second.frames[index];
+	}
+
+	// the video is decoded without holding the lock, so different clips are loaded in parallel;
+	// if another thread loaded the same clip in the meantime its frames are kept
+	ClipFrames clip = loadClip(clipPath);
+	lock_guard<mutex> lock(mutex_);
+	return clips_.emplace(key, clip).first->second.frames[index];
+}
+
+/**
+ * @brief Remove all the loaded clips from memory.
+ */
+void FrameStore::clear() {
+	lock_guard<mutex> lock(mutex_);
+	clips_.clear();
+}
@@ -0,0 +1,88 @@
+// Author: Michele Sprocatti
+
+#include "frameRing.h"
+
+#include <stdexcept>
+
+using namespace std;
+using namespace cv;
+
+/**
+ * @brief Constructor.
+ * @param capacity maximum number of retained frames.
+ * @throw invalid_argument if capacity is less than 1.
+ */
+FrameRingBuffer::FrameRingBuffer(int capacity) {
+	if (capacity < 1)
+		throw invalid_argument("The capacity must be at least 1");
+	slots_ = vector<Mat>(capacity);
+	newest_ = capacity - 1;
+	size_ = 0;
+}
+
+/**
+ * @brief Decode the next frame of the video into the buffer.
+ * The frame is decoded in the spare slot, then the spare slot and the oldest slot are swapped: the new frame
+ * enters the ring and the memory of the evicted frame is reused by the next read.
+ * If the read fails the retained frames are not modified.
+ * @param video video to read.
+ * @return true if a frame has been read, false at the end of the video.
+ */
+bool FrameRingBuffer::read(VideoCapture &video) {
+	if (!video.read(spare_))
+		return false;
+
+	newest_ = (newest_ + 1) % static_cast<int>(slots_.size());
+	swap(slots_[newest_], spare_);
+	if (size_ < slots_.size())
+		size_++;
+	return true;
+}
+
+/**
+ * @brief Read the next frame of a shared memory stream into the buffer, without copies.
+ * The spare slot receives a header on the shared memory, then it is swapped with the oldest slot like for a video.
+ * The source must retain at least the capacity of the buffer, so the retained frames are not overwritten by the
+ * producer, and a buffer must not mix the two kinds of input, since a video would be decoded in the shared memory.
+ * @param source stream to read.
+ * @return true if a frame has been read, false at the end of the stream.
+ */
+bool FrameRingBuffer::read(SharedFrameSource &source) {
+	if (!source.read(spare_))
+		return false;
+
+	newest_ = (newest_ + 1) % static_cast<int>(slots_.size());
+	swap(slots_[newest_], spare_);
+	if (size_ < slots_.size())
+		size_++;
+	return true;
+}
+
+/**
+ * @brief Return a retained frame.
+ * @param age 0 for the most recent frame, 1 for the previous one and so on.
+ * @return the frame.
+ * @throw invalid_argument if the frame is not retained.
+ */
+const Mat &FrameRingBuffer::get(int age /*= 0*/) const {
+	if (age < 0 || age >= size_)
+		throw invalid_argument("Frame not retained in the buffer");
+	int capacity = slots_.size();
+	return slots_[(newest_ - age + capacity) % capacity];
+}
+
+/**
+ * @brief Return the number of retained frames.
+ * @return the number of frames.
+ */
+int FrameRingBuffer::size() const {
+	return size_;
+}
+
+/**
+ * @brief Return the maximum number of retained frames.
+ * @return the capacity.
+ */
+int FrameRingBuffer::capacity() const {
+	return slots_.size();
+}
@@ -0,0 +1,244 @@
+// Author: Alberto Pasqualetto
+
+#include "groundTruth.h"
+
+#include <stdexcept>
+#include <filesystem>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+using namespace std;
+using namespace cv;
+
+// layout of the binary cache: header, bounding boxes of the two frames, masks of the two frames aligned to 64 bytes
+const uint32_t CACHE_MAGIC = 0x38425047;	// "GPB8"
+const uint32_t CACHE_VERSION = 1;
+const size_t CACHE_ALIGNMENT = 64;
+const int CACHE_BBOX_FIELDS = 5;	// x, y, width, height, category
+
+/**
+ * Header of the binary cache.
+ */
+struct CacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	int32_t rows[2];
+	int32_t cols[2];
+	int32_t bboxCount[2];
+};
+
+/**
+ * @brief Round a size up to the cache alignment.
+ * @param size size in bytes.
+ * @return the smallest multiple of the alignment greater or equal to size.
+ */
+size_t alignCacheOffset(size_t size) {
+	return (size + CACHE_ALIGNMENT - 1) / CACHE_ALIGNMENT * CACHE_ALIGNMENT;
+}
+
+/**
+ * @brief Compute the offsets of the masks in the cache.
+ * @param header header of the cache.
+ * @param maskOffsets output offsets of the masks of the two frames.
+ * @return the total size of the cache.
+ */
+size_t cacheLayout(const CacheHeader &header, size_t maskOffsets[2]) {
+	size_t offset = sizeof(CacheHeader);
+	for (int f = 0; f < 2; f++)
+		offset += static_cast<size_t>(header.bboxCount[f]) * CACHE_BBOX_FIELDS * sizeof(int32_t);
+	for (int f = 0; f < 2; f++) {
+		offset = alignCacheOffset(offset);
+		maskOffsets[f] = offset;
+		offset += static_cast<size_t>(header.rows[f]) * header.cols[f];
+	}
+	return offset;
+}
+
+/**
+ * @brief Write the ground truth of a clip in the binary cache.
+ * @param path path of the cache.
+ * @param frames ground truth of the first and the last frame.
+ * @return true if the cache has been written, false otherwise.
+ */
+bool writeGroundTruthCache(const string &path, const GroundTruthFrame frames[2]) {
+	CacheHeader header;
+	header.magic = CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	for (int f = 0; f < 2; f++) {
+		header.rows[f] = frames[f].mask.rows;
+		header.cols[f] = frames[f].mask.cols;
+		header.bboxCount[f] = frames[f].bboxes.size();
+	}
+	size_t maskOffsets[2];
+	size_t size = cacheLayout(header, maskOffsets);
+
+	vector<unsigned char> content(size, 0);
+	memcpy(content.data(), &header, sizeof(CacheHeader));
+	size_t offset = sizeof(CacheHeader);
+	for (int f = 0; f < 2; f++) {
+		for (const pair<Rect, Category> &bbox : frames[f].bboxes) {
+			int32_t fields[CACHE_BBOX_FIELDS] = {bbox.first.x, bbox.first.y, bbox.first.width, bbox.first.height, bbox.second};
+			memcpy(content.data() + offset, fields, sizeof(fields));
+			offset += sizeof(fields);
+		}
+	}
+	for (int f = 0; f < 2; f++) {
+		const Mat &mask = frames[f].mask;
+		for (int i = 0; i < mask.rows; i++)
+			memcpy(content.data() + maskOffsets[f] + static_cast<size_t>(i) * mask.cols, mask.ptr<uchar>(i), mask.cols);
+	}
+
+	// write to a temporary file first, then rename it, so a partially written cache is never read
+	string temporaryPath = path + ".tmp";
+	{
+		ofstream file(temporaryPath, ios::binary);
+		if (!file.is_open())
+			return false;
+		file.write(reinterpret_cast<const char *>(content.data()), content.size());
+		if (!file.good())
+			return false;
+	}
+	error_code error;
+	filesystem::rename(temporaryPath, path, error);
+	return !error;
+}
+
+/**
+ * @brief Read the ground truth of a clip from the binary cache.
+ * The masks are not copied: they point to the memory of the mapped cache.
+ * @param path path of the cache.
+ * @param cache output mapped cache, it owns the memory of the masks.
+ * @param frames output ground truth of the first and the last frame.
+ * @return true if the cache is valid and has been read, false otherwise.
+ */
+bool readGroundTruthCache(const string &path, Ptr<MappedFile> &cache, GroundTruthFrame frames[2]) {
+	try {
+		cache = makePtr<MappedFile>(path);
+	} catch (const runtime_error &) {
+		return false;
+	}
+
+	if (cache->size() < sizeof(CacheHeader))
+		return false;
+
+	CacheHeader header;
+	memcpy(&header, cache->data(), sizeof(CacheHeader));
+	if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION)
+		return false;
+	for (int f = 0; f < 2; f++)
+		if (header.rows[f] <= 0 || header.cols[f] <= 0 || header.bboxCount[f] < 0)
+			return false;
+
+	size_t maskOffsets[2];
+	if (cacheLayout(header, maskOffsets) > cache->size())
+		return false;
+
+	size_t offset = sizeof(CacheHeader);
+	for (int f = 0; f < 2; f++) {
+		frames[f].bboxes.clear();
+		for (int b = 0; b < header.bboxCount[f]; b++) {
+			int32_t fields[CACHE_BBOX_FIELDS];
+			memcpy(fields, cache->data() + offset, sizeof(fields));
+			offset += sizeof(fields);
+			frames[f].bboxes.push_back(make_pair(Rect(fields[0], fields[1], fields[2], fields[3]), static_cast<Category>(fields[4])));
+		}
+		frames[f].mask = Mat(header.rows[f], header.cols[f], CV_8UC1, cache->data() + maskOffsets[f]);
+	}
+	return true;
+}
+
+/**
+ * @brief Return the store shared by the whole program.
+ * @return the store.
+ */
+GroundTruthStore &GroundTruthStore::instance() {
+	static GroundTruthStore store;
+	return store;
+}
+
+/**
+ * @brief Load the ground truth of a clip from the cache or from the original files.
+ * The cache is used only if it is newer than all the original files, otherwise the masks are decoded, the bounding
+ * boxes are parsed and the cache is rebuilt. If the cache cannot be written the ground truth is kept only in memory.
+ * @param clipPath path to the folder of the clip.
+ * @return the ground truth of the clip.
+ * @throw invalid_argument if the original files are not found.
+ */
+GroundTruthStore::ClipGroundTruth GroundTruthStore::loadClip(const string &clipPath) {
+	filesystem::path folder = filesystem::path(clipPath);
+	filesystem::path cachePath = folder / GROUND_TRUTH_CACHE_NAME;
+	const filesystem::path SOURCES[2][2] = {
+		{folder / "masks" / "frame_first.png", folder / "bounding_boxes" / "frame_first_bbox.txt"},
+		{folder / "masks" / "frame_last.png", folder / "bounding_boxes" / "frame_last_bbox.txt"}
+	};
+
+	ClipGroundTruth clip;
+
+	// use the cache only if it is up to date
+	error_code error;
+	bool cacheValid = filesystem::exists(cachePath, error);
+	for (int f = 0; f < 2 && cacheValid; f++)
+		for (int s = 0; s < 2 && cacheValid; s++)
+			cacheValid = filesystem::exists(SOURCES[f][s], error)
+						&& filesystem::last_write_time(SOURCES[f][s]) <= filesystem::last_write_time(cachePath);
+
+	if (cacheValid && readGroundTruthCache(cachePath.string(), clip.cache, clip.frames))
+		return clip;
+
+	clip.cache.release();
+	for (int f = 0; f < 2; f++) {
+		clip.frames[f].mask = imread(SOURCES[f][0].string(), IMREAD_GRAYSCALE);
+		if (clip.frames[f].mask.empty())
+			throw invalid_argument("Ground truth mask not found: " + SOURCES[f][0].string());
+		clip.frames[f].bboxes = readGroundTruthBboxFile(SOURCES[f][1].string());
+	}
+	writeGroundTruthCache(cachePath.string(), clip.frames);
+	return clip;
+}
+
+/**
+ * @brief Return the ground truth of a frame of a clip, loading it if needed.
+ * The lock protects only the map of the entries, each clip is loaded outside of it and only once: the other threads
+ * that need the same clip wait for it, while the ones that need other clips are not blocked. If the loading throws,
+ * the next call tries again.
+ * @param clipPath path to the folder of the clip.
+ * @param frameN Set to FIRST for the first frame, LAST for the last frame.
+ * @return the ground truth of the frame, valid until the store is cleared. The mask must not be modified.
+ * @throw invalid_argument if frameN is not FIRST or LAST or if the original files are not found.
+ */
+const GroundTruthFrame &GroundTruthStore::get(const string &clipPath, FrameN frameN) {
+	int index;
+	switch (frameN) {
+		case FIRST:
+			index = 0;
+			break;
+		case LAST:
+			index = 1;
+			break;
+		default:
+			throw invalid_argument("frameN must be FIRST or LAST");
+	}
+
+	string key = filesystem::path(clipPath).lexically_normal().string();
+	ClipEntry *entry;
+	{
+		lock_guard<mutex> lock(mutex_);
+		entry = &clips_[key];	// the elements of a map are never moved
+	}
+	call_once(entry->loaded, [&]() {
+		entry->clip = loadClip(clipPath);
+	});
+
+	return entry->clip.frames[index];
+}
+
+/**
+ * @brief Remove all the loaded clips from memory.
+ */
+void GroundTruthStore::clear() {
+	lock_guard<mutex> lock(mutex_);
+	clips_.clear();
+}
@@ -6,160 +6,253 @@
 #include <filesystem>
 #include <chrono>
 
-#include "minimap.h"
 #include "ball.h"
 #include "table.h"
-#include "detection.h"
 #include "segmentation.h"
-#include "transformation.h"
-#include "tracking.h"
 #include "metrics.h"
+#include "poolAnalyzer.h"
+#include "profiler.h"
+#include "frameRing.h"
+#include "videoIO.h"
+#include "sharedFrames.h"
 #include "util.h"
 
 using namespace std;
 using namespace cv;
 using namespace chrono;
 
+// number of decoded frames kept in memory
+const int FRAME_HISTORY = 4;
+
+// maximum number of frames between two tracked frames when frames are skipped
+const int MAX_TRACKING_STEP = 4;
+
+// number of frames between two updates of the color model of the table when the color is adaptive
+const int COLOR_MODEL_INTERVAL = 15;
+
+// prefix of the input when the frames are read from a shared memory stream
+const string SHARED_INPUT_PREFIX = "shm:";
+
+// prefix of the option that selects the algorithm used to find the circles of the balls
+const string BALL_DETECTOR_OPTION = "--ball-detector=";
+
 /* 	Given a video, it detects table and balls in the first frame and tracks the balls over different frames.
 	Using this information then it creates the output video with a minimap superimposed and then detects the balls
-	in the last frame. For the detection of the table and of the balls it computes also some performance metrics. */
+	in the last frame. For the detection of the table and of the balls it computes also some performance metrics.
+	The analysis is done by PoolAnalyzer, this program reads the frames, writes the output and shows the results. */
 int main(int argc, char *argv[]) {
 	//VARIABLES
 	filesystem::path videoPath;
 	filesystem::path outputPath = "../Output";
 	Mat frame;
-	Vec2b colorTable;
-	Table table;
-	Vec<Point2f, 4> tableCorners;
 	Mat segmented;
-	int frameCount = 0;
-	Mat previousFrame;
 	Mat detected;
-	Mat res;
+	Mat minimapWithBalls;
 	vector<double> metricsAP;
 	vector<double> metricsIoU;
-	const int FRAME_VISUALITAION_STEP = 60;
 
 	//INPUT
-	if (argc == 2) {
-		videoPath = filesystem::path(argv[1]);
+	// the input is the path of a video or shm:<name> to read the frames published in shared memory by a local
+	// producer (see SharedFramesProducer), in this case the metrics are not computed since there is no ground truth;
+	// with the optional --profile flag the time of each stage is measured and saved as a trace,
+	// with the optional --fast-io flag the fastest decoder and encoder are used,
+	// with the optional --skip-frames flag the balls are not tracked in all the frames,
+	// with the optional --adaptive-color flag the color of the table follows the changes of the lighting,
+	// with the optional --ball-detector=<name> option the circles of the balls are found by another algorithm,
+	// with the optional --tiled-detection flag the balls are detected on tiles of the table in parallel
+	bool fastIO = false;
+	bool skipFrames = false;
+	bool adaptiveColor = false;
+	BallDetectorType ballDetector = HOUGH_BALL_DETECTOR;
+	bool tiledDetection = false;
+	bool badArguments = argc < 2;
+	for (int i = 2; i < argc; i++) {
+		if (string(argv[i]) == "--profile")
+			Profiler::instance().setEnabled(true);
+		else if (string(argv[i]) == "--fast-io")
+			fastIO = true;
+		else if (string(argv[i]) == "--skip-frames")
+			skipFrames = true;
+		else if (string(argv[i]) == "--adaptive-color")
+			adaptiveColor = true;
+		else if (string(argv[i]) == "--tiled-detection")
+			tiledDetection = true;
+		else if (string(argv[i]).rfind(BALL_DETECTOR_OPTION, 0) == 0) {
+			try {
+				ballDetector = ballDetectorFromName(string(argv[i]).substr(BALL_DETECTOR_OPTION.size()));
+			} catch (const invalid_argument &e) {
+				cout << e.what() << endl;
+				badArguments = true;
+			}
+		}
+		else
+			badArguments = true;
+	}
+	string sharedName;
+	if (!badArguments) {
+		string input = string(argv[1]);
+		if (input.rfind(SHARED_INPUT_PREFIX, 0) == 0) {
+			sharedName = input.substr(SHARED_INPUT_PREFIX.size());
+			if (sharedName.empty() || sharedName[0] != '/')
+				sharedName = "/" + sharedName;
+			videoPath = filesystem::path(sharedName);
+		} else {
+			videoPath = filesystem::path(input);
+		}
 	}
 	else {
-		cout << "Error of number of parameters: insert one parameter" << endl;
+		cout << "Error of number of parameters: insert the video path or shm:<name> and optionally --profile, --fast-io, --skip-frames, --adaptive-color, --ball-detector=<name> and --tiled-detection" << endl;
 		return -1;
 	}
-	cout << "Video path: " << videoPath << endl;
+	bool sharedInput = !sharedName.empty();
+	if (sharedInput)
+		cout << "Shared memory input: " << sharedName << endl;
+	else
+		cout << "Video path: " << videoPath << endl;
+
+	//VIDEO INPUT/OUTPUT CONFIGURATION
+	VideoIOConfig ioConfig;
+	if (fastIO && sharedInput) {
+		cout << "--fast-io ignored: the frames are not decoded from a video" << endl;
+	} else if (fastIO) {
+		try {
+			filesystem::create_directories(outputPath);
+			ioConfig = selectFastestVideoIO(videoPath.string(), (outputPath / "video_io.yml").string());
+		} catch (const invalid_argument &e) {
+			cout << "Error selecting the video backends: " << e.what() << endl;
+			return -1;
+		}
+		cout << "Video I/O: " << describeVideoIO(ioConfig) << endl;
+	}
 
 	//START THE VIDEO
-	VideoCapture vid = VideoCapture(videoPath.string());
+	// the last frames are kept without copies, the last one is used for the final detection
+	// and the frames skipped by the tracker wait there until the next tracked frame
+	FrameRingBuffer frames = FrameRingBuffer(FRAME_HISTORY + MAX_TRACKING_STEP);
+	VideoCapture vid;
+	Ptr<SharedFrameSource> sharedSource;
+	if (sharedInput) {
+		// the producer does not overwrite the frames retained by the ring buffer
+		try {
+			sharedSource = makePtr<SharedFrameSource>(sharedName, frames.capacity());
+		} catch (const exception &e) {
+			cout << "Error opening shared memory: " << e.what() << endl;
+			return -1;
+		}
+	} else {
+		openCapture(vid, videoPath.string(), ioConfig);
+	}
+	auto readFrame = [&]() {
+		return sharedInput ? frames.read(*sharedSource) : frames.read(vid);
+	};
 
 	// work on first frame
-	if (!vid.isOpened() || !vid.read(frame)) {
+	if ((!sharedInput && !vid.isOpened()) || !readFrame()) {
 		cout << "Error opening video file" << endl;
 		return -1;
 	}
+	frame = frames.get();
 	string videoName = videoPath.stem().string();
-	string outputVideoName = videoName + "_output.mp4";
+	string outputVideoName = videoName + "_output" + codecExtension(ioConfig.codec);
 	outputPath = outputPath / outputVideoName;
-	++frameCount;
 	//imshow("First frame", frame);
 
 	filesystem::path tempOutputPath = filesystem::temp_directory_path() / outputVideoName;
-	int codec = VideoWriter::fourcc('m', 'p', '4', 'v');
 	VideoWriter vidOutput = VideoWriter();
-	double fps = vid.get(CAP_PROP_FPS);
-	vidOutput.open(tempOutputPath.string(), codec, fps, frame.size(), true);
+	double fps = sharedInput ? sharedSource->getFps() : vid.get(CAP_PROP_FPS);
+	if (!openWriter(vidOutput, tempOutputPath.string(), fps, frame.size(), ioConfig)) {
+		cout << "Error opening output video file " << tempOutputPath << endl;
+		return -1;
+	}
 
-	//DETECT AND SEGMENT TABLE
-	detectTable(frame, tableCorners, colorTable);
-	table = Table(tableCorners, colorTable);
-	segmentTable(frame, table, segmented);
-	//imshow("segmentedTable", segmented);
+	//ANALYZER
+	// with --skip-frames the balls are tracked only in some frames and interpolated in the others,
+	// with --adaptive-color the color model of the table is updated periodically
+	PoolAnalyzerConfig config;
+	config.maxTrackingStep = skipFrames ? MAX_TRACKING_STEP : 1;
+	config.colorModelInterval = adaptiveColor ? COLOR_MODEL_INTERVAL : 0;
+	config.detection.balls.detector = ballDetector;
+	config.detection.balls.tiled = tiledDetection;
+	PoolAnalyzer analyzer = PoolAnalyzer(config);
 
-	//DETECT AND SEGMENT BALLS
-	detectBalls(frame, table);
+	// detect and segment table and balls, compute the transformation and draw the first minimap
+	const FrameResult &first = analyzer.init(frame, fps);
+	Table &table = analyzer.getTable();
 	drawBoundingBoxes(frame, table, detected);
 	imshow("detected balls first frame", detected);
+	imshow("segmented balls first frame", analyzer.getSegmentation());
+	if (!sharedInput) {
+		cout << "Metrics first frame:" << endl;
+		metricsAP = compareMetricsAP(table, videoPath.parent_path().string(), FIRST);
+		metricsIoU = compareMetricsIoU(analyzer.getSegmentation(), videoPath.parent_path().string(), FIRST);
+		for (int c = 0; c < metricsAP.size(); c++)
+			cout << "AP for category " << c + 1 << ": " << metricsAP[c] << endl;
 
-	segmentBalls(segmented, table.ballsPtr(), segmented);
-	imshow("segmented balls first frame", segmented);
-	cout << "Metrics first frame:" << endl;
-	metricsAP = compareMetricsAP(table, videoPath.parent_path().string(), FIRST);
-	metricsIoU = compareMetricsIoU(segmented, videoPath.parent_path().string(), FIRST);
-	for (int c = 0; c < metricsAP.size(); c++)
-		cout << "AP for category " << c + 1 << ": " << metricsAP[c] << endl;
-
-	for (int c = 0; c < metricsIoU.size(); c++)
-		cout << "IoU for category " << c << ": " << metricsIoU[c] << endl;
+		for (int c = 0; c < metricsIoU.size(); c++)
+			cout << "IoU for category " << c << ": " << metricsIoU[c] << endl;
+	}
+	minimapWithBalls = first.minimap;
+	vidOutput.write(first.output);
 
 	waitKey(0);
 
-	//TRANSFORMATION
-	Vec<Point2f, 4> imgCorners = table.getBoundaries();
-	table.setTransform(computeTransformation(segmented, imgCorners));
-	table.setBoundaries(imgCorners);
-
-	//MINIMAP
-	// The original is the png provided but we converted it to an header
-	// Mat minimap = imread(MINIMAP_PATH);
-	vector<unsigned char> minimapVec(MINIMAP_DATA, MINIMAP_DATA + MINIMAP_DATA_SIZE);
-	Mat minimap = imdecode(minimapVec, IMREAD_COLOR);
-
-
-	Mat minimapWithTrack = minimap.clone();
-	Mat minimapWithBalls = minimap.clone();
-	// imshow("minimap", minimap);
-
-	Mat transform = table.getTransform();
-	minimapWithBalls = drawMinimap(minimapWithTrack, transform, table.ballsPtr());
-	//imshow("Minimap with balls", minimapWithBalls);
-	createOutputImage(frame, minimapWithBalls, res);
-	//imshow("result", res);
-	vidOutput.write(res);
+	// write the results of the analyzed frames in the output video
+	auto writeResults = [&](const vector<FrameResult> &results) {
+		for (int j = 0; j < results.size(); j++) {
+			const FrameResult &result = results[j];
+			minimapWithBalls = result.minimap;
+			//imshow("result", result.output);
+			{
+				ScopedTimer writeTimer("writeFrame");
+				vidOutput.write(result.output);
+			}
+			// show status when the scene comes to rest
+			if (result.atRest) {
+				frame = frames.get(results.size() - 1 - j);
+				// the balls of the result are the interpolated ones if the frame has been skipped;
+				// shrink is needed because for the tracking we enlarge the bounding box to have better tracking performances
+				vector<Ball> restBalls = result.balls;
+				for(int i = 0; i < restBalls.size(); i++){
+					Rect r = restBalls[i].getBbox();
+					shrinkRect(r, 10);
+					restBalls[i].setBbox(r);
+				}
+				// the table is segmented again only if its color changed, otherwise only the balls are drawn on the cached segmentation
+				segmented = analyzer.segmentCurrentBalls(frame, restBalls);
+				drawBoundingBoxes(frame, table, restBalls, detected);
+				//imshow("frame " + to_string(result.frame), frame);
+				imshow("segmented balls " + to_string(result.frame) + " frame", segmented);
+				imshow("detected balls " + to_string(result.frame) + " frame", detected);
+				imshow("Minimap with balls " + to_string(result.frame) + " frame", result.minimap);
+				waitKey(0);
+			}
+		}
+	};
 
-	//TRACKER
-	BilliardTracker tracker = BilliardTracker(table.ballsPtr());
-	tracker.trackAll(frame);
+	// the pending frames are headers on the ring buffer, from the oldest to the most recent
+	vector<Mat> pendingFrames;
+	auto analyzePending = [&]() {
+		for (int j = 0; j < pendingFrames.size(); j++)
+			pendingFrames[j] = frames.get(pendingFrames.size() - 1 - j);
+		writeResults(analyzer.process(pendingFrames));
+		pendingFrames.clear();
+	};
 
 	//VIDEO WITH MINIMAP
 	// time_point start = high_resolution_clock::now();
-	bool ret = vid.read(frame);
-	while (vid.isOpened() && ret) { // work on middle frames
-
-		++frameCount;
- 		//VIDEO WITH MINIMAP
-		tracker.trackAll(frame);
-		minimapWithBalls = drawMinimap(minimapWithTrack, transform, table.ballsPtr());
-		createOutputImage(frame, minimapWithBalls, res);
-		//imshow("result", res);
-		vidOutput.write(res);
-		// show status every X frame
-		if (frameCount % FRAME_VISUALITAION_STEP == 0) {
-			// enlarge and shrink are needed because for the tracking
-			// we enlarge the bounding box to have better tracking performances
-			for(int i = 0; i < table.ballsPtr()->size(); i++){
-				Rect r = table.ballsPtr()->at(i).getBbox();
-				shrinkRect(r, 10);
-				table.ballsPtr()->at(i).setBbox(r);
-			}
-			segmentTable(frame, table, segmented);
-			segmentBalls(segmented, table.ballsPtr(), segmented);
-			drawBoundingBoxes(frame, table, detected);
-			//imshow("frame " + to_string(frameCount), frame);
-			imshow("segmented balls " + to_string(frameCount) + " frame", segmented);
-			imshow("detected balls " + to_string(frameCount) + " frame", detected);
-			imshow("Minimap with balls " + to_string(frameCount) + " frame", minimapWithBalls);
-			for(int i = 0; i < table.ballsPtr()->size(); i++){
-				Rect r = table.ballsPtr()->at(i).getBbox();
-				enlargeRect(r, 10);
-				table.ballsPtr()->at(i).setBbox(r);
-			}
-			waitKey(0);
-		}
+	pendingFrames.reserve(MAX_TRACKING_STEP);
+	bool ret = readFrame();
+	while (ret) { // work on middle frames
+		pendingFrames.emplace_back();
+		if (pendingFrames.size() >= analyzer.getStep())
+			analyzePending();
 
-		previousFrame = frame.clone();
-		ret = vid.read(frame);
+		ScopedTimer readTimer("readFrame");
+		ret = readFrame();
 	}
+	// the last frames are analyzed even if they are less than the step
+	if (!pendingFrames.empty())
+		analyzePending();
 
 	// time_point stop = high_resolution_clock::now();
 	// minutes duration = duration_cast<minutes>(stop - start);
@@ -168,23 +261,38 @@ int main(int argc, char *argv[]) {
 
 	imwrite("../Output/minimap/" + videoName + "_minimap.png", minimapWithBalls);
 
+	// stream of the events of the video
+	filesystem::path eventsPath = filesystem::path("../Output/events");
+	filesystem::create_directories(eventsPath);
+	analyzer.getEvents().writeEvents((eventsPath / (videoName + "_events.csv")).string());
+	cout << "Events detected: " << analyzer.getEvents().getEvents().size() << endl;
+
+	// time spent in each stage
+	if (Profiler::instance().isEnabled()) {
+		Profiler::instance().setEnabled(false);
+		filesystem::path tracePath = filesystem::path("../Output/trace");
+		filesystem::create_directories(tracePath);
+		Profiler::instance().writeTrace((tracePath / (videoName + "_trace.json")).string());
+		Profiler::instance().printSummary(cout);
+	}
+
 	// work on last frame
-	table.clearBalls();
-	detectBalls(previousFrame, table);
-	drawBoundingBoxes(previousFrame, table, detected);
+	const Mat &lastFrame = frames.get();
+	analyzer.finish(lastFrame);
+	drawBoundingBoxes(lastFrame, table, detected);
 	imshow("detected balls last frame", detected);
-	segmentTable(previousFrame, table, segmented);
-	segmentBalls(segmented, table.ballsPtr(), segmented);
-	imshow("segmented balls last frame", segmented);
-	cout << "Metrics last frame:" << endl;
-	metricsAP = compareMetricsAP(table, videoPath.parent_path().string(), LAST);
-	metricsIoU = compareMetricsIoU(segmented, videoPath.parent_path().string(), LAST);
-
-	for (int c = 0; c < metricsAP.size(); c++)
-		cout << "AP for category " << c + 1 << ": " << metricsAP[c] << endl;
-
-	for (int c = 0; c < metricsIoU.size(); c++)
-		cout << "IoU for category " << c << ": " << metricsIoU[c] << endl;
+	imshow("segmented balls last frame", analyzer.getSegmentation());
+	if (!sharedInput) {
+		cout << "Metrics last frame:" << endl;
+		metricsAP = compareMetricsAP(table, videoPath.parent_path().string(), LAST);
+		metricsIoU = compareMetricsIoU(analyzer.getSegmentation(), videoPath.parent_path().string(), LAST);
+
+		for (int c = 0; c < metricsAP.size(); c++)
+			cout << "AP for category " << c + 1 << ": " << metricsAP[c] << endl;
+
+		for (int c = 0; c < metricsIoU.size(); c++)
+			cout << "IoU for category " << c << ": " << metricsIoU[c] << endl;
+	}
 
 	// write to a temp file first, then rename to the final name
 	filesystem::copy(tempOutputPath, outputPath, filesystem::copy_options::overwrite_existing);
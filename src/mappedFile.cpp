@@ -0,0 +1,88 @@
+// Author: Alberto Pasqualetto
+
+#include "mappedFile.h"
+
+#include <stdexcept>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_MMAP
+#endif
+
+using namespace std;
+
+/**
+ * @brief Constructor.
+ * On POSIX systems the file is mapped with a private copy-on-write mapping, otherwise it is read in a buffer.
+ * @param path path of the file to map.
+ * @throw runtime_error if the file cannot be opened or mapped.
+ */
+MappedFile::MappedFile(const string &path) {
+	data_ = nullptr;
+	size_ = 0;
+	mapped_ = false;
+
+#ifdef MAPPED_FILE_MMAP
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw runtime_error("Cannot open file " + path);
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0) {
+		close(fd);
+		throw runtime_error("Cannot read the size of file " + path);
+	}
+	size_ = fileStat.st_size;
+
+	if (size_ > 0) {
+		void *address = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (address == MAP_FAILED) {
+			close(fd);
+			throw runtime_error("Cannot map file " + path);
+		}
+		data_ = static_cast<unsigned char *>(address);
+		mapped_ = true;
+	}
+	close(fd);	// the mapping is still valid after closing the file descriptor
+#else
+	ifstream file(path, ios::binary | ios::ate);
+	if (!file.is_open())
+		throw runtime_error("Cannot open file " + path);
+
+	size_ = file.tellg();
+	buffer_.resize(size_);
+	file.seekg(0);
+	file.read(reinterpret_cast<char *>(buffer_.data()), size_);
+	data_ = buffer_.data();
+#endif
+}
+
+/**
+ * @brief Destructor, it releases the mapping.
+ */
+MappedFile::~MappedFile() {
+#ifdef MAPPED_FILE_MMAP
+	if (mapped_)
+		munmap(data_, size_);
+#endif
+}
+
+/**
+ * @brief Return the content of the file.
+ * @return a pointer to the first byte of the file.
+ */
+unsigned char *MappedFile::data() const {
+	return data_;
+}
+
+/**
+ * @brief Return the size of the file.
+ * @return the size of the file in bytes.
+ */
+size_t MappedFile::size() const {
+	return size_;
+}
@@ -0,0 +1,167 @@
+// Author: Michela Schibuola
+
+#include "metricSpace.h"
+
+#include <stdexcept>
+#include <opencv2/opencv.hpp>
+#include "constants.h"
+
+using namespace cv;
+using namespace std;
+
+/**
+ * @brief Convert a position in the minimap to the table coordinates.
+ * The minimap is a scaled view of the table, so the conversion is a translation to the top left corner of the
+ * playing field and a scaling by MAP_PX_TO_CM.
+ * @param mapPosition position in the minimap, in pixels.
+ * @return position on the playing field in centimeters, from the top left corner.
+ */
+Point2f minimapToTable(const Point2f &mapPosition) {
+	return (mapPosition - TOP_LEFT_MAP_CORNER) * MAP_PX_TO_CM;
+}
+
+/**
+ * @brief Compute the transformation from the frame to the table coordinates.
+ * It is the transformation to the minimap followed by the conversion of minimapToTable.
+ * @param transform transformation matrix from the frame to the minimap, as computed by computeTransformation.
+ * @return the transformation matrix from the frame to the playing field in centimeters.
+ * @throw invalid_argument if the transformation matrix in input is empty.
+ */
+Mat computeTableTransformation(const Mat &transform) {
+	if(transform.empty())
+		throw invalid_argument("Empty transformation matrix in input");
+
+	Mat toTable = (Mat_<double>(3, 3) <<
+			MAP_PX_TO_CM, 0, -TOP_LEFT_MAP_CORNER.x * MAP_PX_TO_CM,
+			0, MAP_PX_TO_CM, -TOP_LEFT_MAP_CORNER.y * MAP_PX_TO_CM,
+			0, 0, 1);
+	Mat transform64;
+	transform.convertTo(transform64, CV_64F);
+	return toTable * transform64;
+}
+
+/**
+ * @brief Constructor.
+ * The coefficients of the Savitzky-Golay filter are the rows of the pseudo-inverse of the Vandermonde matrix of
+ * the frame offsets -halfWindow...halfWindow with the powers 0, 1 and 2.
+ * @param fps frame rate of the video.
+ * @param halfWindow number of frames before and after the estimated frame, it is the lag of the estimates.
+ * @throw invalid_argument if fps is not positive or if halfWindow is less than 1.
+ */
+BallMotionEstimator::BallMotionEstimator(double fps, int halfWindow /*= 3*/) {
+	if(halfWindow < 1)
+		throw invalid_argument("The half window must be at least 1");
+
+	halfWindow_ = halfWindow;
+	reset(fps);
+
+	const int window = 2 * halfWindow + 1;
+	Mat vandermonde = Mat(window, 3, CV_64F);
+	for(int k = 0; k < window; k++) {
+		double offset = k - halfWindow;
+		vandermonde.at<double>(k, 0) = 1;
+		vandermonde.at<double>(k, 1) = offset;
+		vandermonde.at<double>(k, 2) = offset * offset;
+	}
+	invert(vandermonde, coefficients_, DECOMP_SVD);
+}
+
+/**
+ * @brief Start estimating the motion in a new clip, the window and its coefficients are kept.
+ * The samples of the previous clip are discarded, their buffers are reused by the next update.
+ * @param fps frame rate of the video.
+ * @throw invalid_argument if fps is not positive.
+ */
+void BallMotionEstimator::reset(double fps) {
+	if(fps <= 0)
+		throw invalid_argument("Frame rate negative or equal to zero");
+
+	fps_ = fps;
+	frame_ = 0;
+	kinematics_.clear();
+}
+
+/**
+ * @brief Add the positions of the balls in a new frame and estimate the motion in the lagged frame.
+ * A sample is valid if the ball is visible and on the playing field. The fitted polynomial p(t) = a0 + a1 t + a2 t^2,
+ * with t in frames from the lagged frame, gives the position a0, the velocity a1 * fps and the acceleration
+ * 2 * a2 * fps^2; a ball without valid samples in all the window has no estimate.
+ * @param frame number of the new frame, starting from 1.
+ * @param positions positions of the balls in the minimap in the new frame.
+ * @param balls balls of the new frame, the balls that are not visible are not sampled.
+ * @return the estimates of the balls in the frame getLaggedFrame().
+ * @throw invalid_argument if positions and balls have different sizes.
+ */
+const vector<BallKinematics> &BallMotionEstimator::update(int frame, const MinimapPositions &positions, const vector<Ball> &balls) {
+	if(positions.current.size() != balls.size())
+		throw invalid_argument("Positions and balls of different sizes");
+
+	const int window = 2 * halfWindow_ + 1;
+	const size_t n = balls.size();
+	if(kinematics_.size() != n) {
+		samples_.assign(n * window, Point2f(0, 0));
+		validSamples_.assign(n * window, false);
+		kinematics_.assign(n, BallKinematics{false, Point2f(0, 0), Point2f(0, 0), Point2f(0, 0), 0});
+	}
+	frame_ = frame;
+
+	// the sample of the frame f is in the element f % window of the ring
+	const int slot = frame % window;
+	for(size_t i = 0; i < n; i++) {
+		samples_[i * window + slot] = minimapToTable(positions.current[i]);
+		validSamples_[i * window + slot] = balls[i].getVisibility() && positions.currentRegion[i] == PLAYING_FIELD_REGION;
+	}
+
+	const double *c0 = coefficients_.ptr<double>(0);
+	const double *c1 = coefficients_.ptr<double>(1);
+	const double *c2 = coefficients_.ptr<double>(2);
+	const int oldest = frame - window + 1;
+	for(size_t i = 0; i < n; i++) {
+		BallKinematics &kinematics = kinematics_[i];
+		kinematics.valid = oldest >= 1;
+		Point2d a0 = Point2d(0, 0), a1 = Point2d(0, 0), a2 = Point2d(0, 0);
+		for(int k = 0; k < window && kinematics.valid; k++) {
+			int element = static_cast<int>(i) * window + (oldest + k) % window;
+			if(!validSamples_[element]) {
+				kinematics.valid = false;
+				break;
+			}
+			Point2d sample = samples_[element];
+			a0 += c0[k] * sample;
+			a1 += c1[k] * sample;
+			a2 += c2[k] * sample;
+		}
+		if(!kinematics.valid)
+			continue;
+
+		kinematics.position = a0;
+		kinematics.velocity = a1 * fps_;
+		kinematics.acceleration = 2 * a2 * fps_ * fps_;
+		kinematics.speed = norm(kinematics.velocity);
+	}
+	return kinematics_;
+}
+
+/**
+ * @brief Return the estimates of the balls in the lagged frame.
+ * @return the estimates, one for each ball.
+ */
+const vector<BallKinematics> &BallMotionEstimator::getKinematics() const {
+	return kinematics_;
+}
+
+/**
+ * @brief Return the frame of the estimates, that is the last updated frame minus the lag.
+ * @return the number of the frame, less than 1 if no frame has been estimated yet.
+ */
+int BallMotionEstimator::getLaggedFrame() const {
+	return frame_ - halfWindow_;
+}
+
+/**
+ * @brief Return the lag of the estimates.
+ * @return the number of frames between the last updated frame and the frame of the estimates.
+ */
+int BallMotionEstimator::getLag() const {
+	return halfWindow_;
+}
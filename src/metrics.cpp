@@ -5,6 +5,7 @@
 #include "table.h"
 #include "ball.h"
 #include "constants.h"
+#include "groundTruth.h"
 #include <stdexcept>
 #include <filesystem>
 #include <stdexcept>
@@ -12,6 +13,9 @@
 #include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
 #include <fstream>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
 
 
 using namespace std;
@@ -29,20 +33,10 @@ using namespace cv;
 vector<double> compareMetricsIoU(const Mat &segmentedImage, const string &folderPath, const FrameN &frameN) {
 	if (segmentedImage.empty())
 		throw invalid_argument("Empty segmentedImage");
-	filesystem::path groundTruthMaskPath;
-	switch (frameN) {
-		case FIRST:
-			groundTruthMaskPath = filesystem::path(folderPath) / "masks" / "frame_first.png";
-			break;
-		case LAST:
-			groundTruthMaskPath = filesystem::path(folderPath) / "masks" / "frame_last.png";
-			break;
-		default:
-			throw invalid_argument("frameN must be FIRST or LAST");
-	}
 
-	// For ball localization, the mean Average Precision (mAP) calculated at IoU threshold 0.5
-	vector<double> IoUs = IoUSegmentation(segmentedImage, groundTruthMaskPath.string());
+	// the ground truth is loaded only once and shared with the other evaluators
+	const GroundTruthFrame &groundTruth = GroundTruthStore::instance().get(folderPath, frameN);
+	vector<double> IoUs = IoUSegmentation(segmentedImage, groundTruth.mask);
 	return IoUs;
 }
 
@@ -54,19 +48,8 @@ vector<double> compareMetricsIoU(const Mat &segmentedImage, const string &folder
  * @return std::vector<double> vector of AP values for each category.
  */
 vector<double> compareMetricsAP(Table &table, const string &folderPath, const FrameN &frameN) {
-	filesystem::path groundTruthBboxPath;
-	switch (frameN) {
-		case FIRST:
-			groundTruthBboxPath = filesystem::path(folderPath) / "bounding_boxes" / "frame_first_bbox.txt";
-			break;
-		case LAST:
-			groundTruthBboxPath = filesystem::path(folderPath) / "bounding_boxes" / "frame_last_bbox.txt";
-			break;
-		default:
-			throw invalid_argument("frameN must be FIRST or LAST");
-	}
-
-	vector<double> APs = APDetection(table.ballsPtr(), groundTruthBboxPath.string(), MAP_IOU_THRESHOLD);
+	const GroundTruthFrame &groundTruth = GroundTruthStore::instance().get(folderPath, frameN);
+	vector<double> APs = APDetection(table.ballsPtr(), groundTruth.bboxes, MAP_IOU_THRESHOLD);
 	return APs;
 }
 
@@ -110,6 +93,21 @@ vector<double> APDetection(Ptr<vector<Ball>> detectedBalls, const string &ground
 		throw invalid_argument("Empty detectedBalls");
 
 	vector<pair<Rect, Category>> groundTruthBboxes = readGroundTruthBboxFile(groundTruthBboxPath);
+	return APDetection(detectedBalls, groundTruthBboxes, iouThreshold);
+}
+
+/**
+ * @brief Compute the Average Precision (AP) for balls detection.
+ * @param detectedBalls vector of detected balls.
+ * @param groundTruthBboxes ground truth bounding boxes with their category.
+ * @param iouThreshold Intersection over Union threshold.
+ * @return std::vector<double> vector of AP values for each category.
+ * @throw invalid_argument if the vector of detected balls is empty.
+ */
+vector<double> APDetection(Ptr<vector<Ball>> detectedBalls, const vector<pair<Rect, Category>> &groundTruthBboxes, float iouThreshold /*= MAP_IOU_THRESHOLD*/){
+	if(detectedBalls->empty())
+		throw invalid_argument("Empty detectedBalls");
+
 	vector<double> APs;
 	for (Category cat = Category::WHITE_BALL; cat <= Category::STRIPED_BALL; cat = static_cast<Category>(cat + 1)) {
 		APs.push_back(APBallCategory(detectedBalls, groundTruthBboxes, cat, iouThreshold));
@@ -129,34 +127,152 @@ vector<double> IoUSegmentation(const Mat &segmentedImage, const string &groundTr
 	if (segmentedImage.empty())
 		throw invalid_argument("Empty segmentedImage");
 
-	// Convert the segmented image from BGR colors to grayscale category-related colors
-	Mat segmentedImageGray = Mat::zeros(segmentedImage.size(), CV_8UC1);
-	for (int i = 0; i < segmentedImage.rows; i++) {
-		for (int j = 0; j < segmentedImage.cols; j++) {
-			if (segmentedImage.at<Vec3b>(i, j) == BACKGROUND_BGR_COLOR) {
-				segmentedImageGray.at<uchar>(i, j) = static_cast<uchar>(Category::BACKGROUND);
-			} else if (segmentedImage.at<Vec3b>(i, j) == WHITE_BGR_COLOR) {
-				segmentedImageGray.at<uchar>(i, j) = static_cast<uchar>(Category::WHITE_BALL);
-			} else if (segmentedImage.at<Vec3b>(i, j) == BLACK_BGR_COLOR) {
-				segmentedImageGray.at<uchar>(i, j) = static_cast<uchar>(Category::BLACK_BALL);
-			} else if (segmentedImage.at<Vec3b>(i, j) == SOLID_BGR_COLOR) {
-				segmentedImageGray.at<uchar>(i, j) = static_cast<uchar>(Category::SOLID_BALL);
-			} else if (segmentedImage.at<Vec3b>(i, j) == STRIPED_BGR_COLOR) {
-				segmentedImageGray.at<uchar>(i, j) = static_cast<uchar>(Category::STRIPED_BALL);
-			} else if (segmentedImage.at<Vec3b>(i, j) == PLAYING_FIELD_BGR_COLOR) {
-				segmentedImageGray.at<uchar>(i, j) = static_cast<uchar>(Category::PLAYING_FIELD);
-			} else {
-				throw invalid_argument("Invalid color");
+	Mat groundTruthMask = imread(groundTruthMaskPath, IMREAD_GRAYSCALE);
+	return IoUSegmentation(segmentedImage, groundTruthMask);
+}
+
+/**
+ * @brief Compute the Intersection over Union between the segmented image and the ground truth mask.
+ * All the IoUs are computed from a single confusion matrix, so the images are scanned only once.
+ * @param segmentedImage segmented image.
+ * @param groundTruthMask ground truth mask, one category label for each pixel.
+ * @return std::vector<double> vector of IoU values for each category.
+ * @throw invalid_argument if one of the images is empty, if they have different sizes,
+ * 			if the segmented image contains a color not associated to a category.
+ */
+vector<double> IoUSegmentation(const Mat &segmentedImage, const Mat &groundTruthMask) {
+	return IoUFromConfusionMatrix(segmentationConfusionMatrix(segmentedImage, groundTruthMask));
+}
+
+/**
+ * Lookup tables used to convert a BGR color of the segmentation to its category.
+ * Each channel value is mapped to a 2 bits code (3 means that the value is not used by any category),
+ * the three codes are combined in a 6 bits index of the table of the categories.
+ */
+struct ColorLookupTable {
+	static constexpr uchar INVALID = 255;
+	uchar channelCode[3][256];
+	uchar category[64];
+
+	ColorLookupTable() {
+		const Vec3b COLORS[NUMBER_CATEGORIES] = {BACKGROUND_BGR_COLOR, WHITE_BGR_COLOR, BLACK_BGR_COLOR,
+												SOLID_BGR_COLOR, STRIPED_BGR_COLOR, PLAYING_FIELD_BGR_COLOR};
+		for (int c = 0; c < 3; c++) {
+			int codes = 0;
+			for (int v = 0; v < 256; v++)
+				channelCode[c][v] = 3;
+			for (const Vec3b &color : COLORS) {
+				if (channelCode[c][color[c]] == 3) {
+					if (codes == 3)
+						throw logic_error("Too many values in a channel of the category colors");
+					channelCode[c][color[c]] = codes++;
+				}
 			}
 		}
+
+		for (int i = 0; i < 64; i++)
+			category[i] = INVALID;
+		for (int cat = 0; cat < NUMBER_CATEGORIES; cat++)
+			category[index(COLORS[cat][0], COLORS[cat][1], COLORS[cat][2])] = static_cast<uchar>(cat);
 	}
 
-	Mat groundTruthMask = imread(groundTruthMaskPath, IMREAD_GRAYSCALE);
+	int index(uchar b, uchar g, uchar r) const {
+		return channelCode[0][b] | (channelCode[1][g] << 2) | (channelCode[2][r] << 4);
+	}
+};
 
-	vector<double> IoUs;
+/**
+ * @brief Compute the confusion matrix between the segmented image and the ground truth mask.
+ * The color of each pixel is converted to its category using lookup tables, and the pair (ground truth, prediction)
+ * is counted in the same scan. The rows are processed in parallel, each worker with its own counters that are
+ * merged at the end.
+ * @param segmentedImage segmented image, BGR format with the colors of the categories.
+ * @param groundTruthMask ground truth mask, one category label for each pixel.
+ * @return ConfusionMatrix the confusion matrix with the ground truth on the rows and the prediction on the columns.
+ * @throw invalid_argument if one of the images is empty, if they have different sizes,
+ * 			if the segmented image contains a color not associated to a category
+ * 			or if the ground truth mask contains a label not associated to a category.
+ */
+ConfusionMatrix segmentationConfusionMatrix(const Mat &segmentedImage, const Mat &groundTruthMask) {
+	if (segmentedImage.empty() || groundTruthMask.empty())
+		throw invalid_argument("Empty image");
+
+	if (segmentedImage.size() != groundTruthMask.size())
+		throw invalid_argument("Different sizes of segmentedImage and groundTruthMask");
+
+	if (segmentedImage.type() != CV_8UC3 || groundTruthMask.type() != CV_8UC1)
+		throw invalid_argument("Invalid type of segmentedImage or groundTruthMask");
+
+	static const ColorLookupTable LUT;
+
+	ConfusionMatrix confusion = ConfusionMatrix::zeros();
+	mutex confusionMutex;
+	atomic<bool> invalidColor(false);
+	atomic<bool> invalidLabel(false);
+
+	parallel_for_(Range(0, segmentedImage.rows), [&](const Range &rows) {
+		int counts[NUMBER_CATEGORIES][NUMBER_CATEGORIES] = {};
+		bool localInvalidColor = false;
+		bool localInvalidLabel = false;
+
+		for (int i = rows.start; i < rows.end; i++) {
+			const Vec3b *segmentedRow = segmentedImage.ptr<Vec3b>(i);
+			const uchar *groundTruthRow = groundTruthMask.ptr<uchar>(i);
+			for (int j = 0; j < segmentedImage.cols; j++) {
+				const Vec3b &color = segmentedRow[j];
+				uchar predicted = LUT.category[LUT.index(color[0], color[1], color[2])];
+				uchar groundTruth = groundTruthRow[j];
+				if (predicted == ColorLookupTable::INVALID) {
+					localInvalidColor = true;
+					continue;
+				}
+				if (groundTruth >= NUMBER_CATEGORIES) {
+					localInvalidLabel = true;
+					continue;
+				}
+				counts[groundTruth][predicted]++;
+			}
+		}
+
+		if (localInvalidColor)
+			invalidColor = true;
+		if (localInvalidLabel)
+			invalidLabel = true;
 
-	for (Category cat = Category::BACKGROUND; cat <= Category::PLAYING_FIELD; cat = static_cast<Category>(cat + 1)) {
-		IoUs.push_back(IoUCategory(segmentedImageGray, groundTruthMask, cat));
+		lock_guard<mutex> lock(confusionMutex);
+		for (int g = 0; g < NUMBER_CATEGORIES; g++)
+			for (int p = 0; p < NUMBER_CATEGORIES; p++)
+				confusion(g, p) += counts[g][p];
+	});
+
+	if (invalidColor)
+		throw invalid_argument("Invalid color");
+
+	if (invalidLabel)
+		throw invalid_argument("Invalid ground truth label");
+
+	return confusion;
+}
+
+/**
+ * @brief Compute the Intersection over Union of each category from a confusion matrix.
+ * For each category the intersection is the diagonal element and the union is the sum of its row and its column
+ * minus the intersection. If the union is empty the IoU is 1, as for the masks.
+ * @param confusion confusion matrix with the ground truth on the rows and the prediction on the columns.
+ * @return std::vector<double> vector of IoU values for each category.
+ */
+vector<double> IoUFromConfusionMatrix(const ConfusionMatrix &confusion) {
+	vector<double> IoUs;
+	for (int cat = 0; cat < NUMBER_CATEGORIES; cat++) {
+		double groundTruthCount = 0;
+		double predictedCount = 0;
+		for (int k = 0; k < NUMBER_CATEGORIES; k++) {
+			groundTruthCount += confusion(cat, k);
+			predictedCount += confusion(k, cat);
+		}
+		double intersection = confusion(cat, cat);
+		double u = groundTruthCount + predictedCount - intersection;
+		IoUs.push_back((u != 0) ? intersection / u : 1.0);
 	}
 
 	return IoUs;
@@ -178,11 +294,37 @@ double APBallCategory(Ptr<vector<Ball>> &detectedBalls, const vector<pair<Rect,
 	if (groundTruthBboxes.empty())
 		throw invalid_argument("Empty groundTruthBboxes");
 
-	// Create a vector of bounding boxes only for the detected balls of the chosen category
-	vector<Rect> detectedBallsBboxesCat;
-	for (const Ball &ball : *detectedBalls) {
+	vector<pair<float, bool>> matches;
+	int groundTruthCount = 0;
+	matchDetections(*detectedBalls, groundTruthBboxes, cat, iouThreshold, matches, groundTruthCount);
+
+	if (matches.empty() && groundTruthCount == 0)
+		return 1; // if there are no balls with that category in both gt and detected return 1
+
+	if (matches.empty() && groundTruthCount != 0)
+		return 0; // if there are no balls with that category in detected but not in gt return 0
+
+	return averagePrecision(matches, groundTruthCount);
+}
+
+/**
+ * @brief Match the detected balls of a category with the ground truth bounding boxes of the same category.
+ * The detections are processed by decreasing confidence, each of them is assigned to the not yet assigned
+ * ground truth with the highest IoU: it is a true positive if that IoU is above the threshold, a false positive otherwise.
+ * @param detectedBalls vector of detected balls.
+ * @param groundTruthBboxes vector of pairs of (Rect, Category) that represent the ground truth bounding boxes.
+ * @param cat Category.
+ * @param iouThreshold Intersection over Union threshold.
+ * @param matches output vector where a pair (confidence, true positive) is appended for each detected ball of the category.
+ * @param groundTruthCount output counter incremented by the number of ground truth bounding boxes of the category.
+ */
+void matchDetections(const vector<Ball> &detectedBalls, const vector<pair<Rect, Category>> &groundTruthBboxes,
+					 Category cat, float iouThreshold, vector<pair<float, bool>> &matches, int &groundTruthCount) {
+	// Create a vector only for the detected balls of the chosen category
+	vector<const Ball *> detectedBallsCat;
+	for (const Ball &ball : detectedBalls) {
 		if (ball.getCategory() == cat) {
-			detectedBallsBboxesCat.push_back(ball.getBbox());
+			detectedBallsCat.push_back(&ball);
 		}
 	}
 
@@ -193,97 +335,68 @@ double APBallCategory(Ptr<vector<Ball>> &detectedBalls, const vector<pair<Rect,
 			groundTruthBboxesCat.push_back(get<Rect>(groundTruthBall));
 		}
 	}
+	groundTruthCount += groundTruthBboxesCat.size();
 
-	if (detectedBallsBboxesCat.empty() && groundTruthBboxesCat.empty())
-		return 1; // if there are no balls with that category in both gt and detected return 1
-
-	if (detectedBallsBboxesCat.empty() && !groundTruthBboxesCat.empty())
-		return 0; // if there are no balls with that category in detected but not in gt return 0
+	// the most confident detections are matched first, ties keep the detection order
+	stable_sort(detectedBallsCat.begin(), detectedBallsCat.end(),
+				[](const Ball *a, const Ball *b) -> bool {
+		return a->getConfidence() > b->getConfidence();   // decreasing order
+	});
 
 	vector<bool> assignedGroundTruths(groundTruthBboxesCat.size(), false);
-
-	// IoUs, tp and fp vectors share the same indexing
-	vector<double> IoUs; // if 0, the ground truth ball has not been assigned to any detected ball
-
-	vector<unsigned short> tp;
-	vector<unsigned short> fp;
-
-	// Couple each detected ball with the ground truth ball using the highest IoU
-	for (int i = 0; i < detectedBallsBboxesCat.size(); i++) {
+	for (const Ball *ball : detectedBallsCat) {
 		double maxIoU = 0;
 		int maxIoUIndex = -1;
 		for (int j = 0; j < groundTruthBboxesCat.size(); j++) {
-			// if there are more ground truths than detected balls, the unassigned ones will be false negatives
-			double iou = IoU(detectedBallsBboxesCat[i], groundTruthBboxesCat[j]);
+			if (assignedGroundTruths[j])
+				continue;
+			double iou = IoU(ball->getBbox(), groundTruthBboxesCat[j]);
 			if (iou > maxIoU) {
 				maxIoU = iou;
 				maxIoUIndex = j;
 			}
 		}
-		if ((maxIoUIndex != -1 && !assignedGroundTruths[maxIoUIndex]) && maxIoU > iouThreshold) {
-			// if there is a ground truth which is not already assigned and true positive
+		bool truePositive = maxIoUIndex != -1 && maxIoU > iouThreshold;
+		if (truePositive)
 			assignedGroundTruths[maxIoUIndex] = true;
-			tp.push_back(1);
-			fp.push_back(0);
-		} else {
-			tp.push_back(0);
-			fp.push_back(1);
-		}
-		IoUs.push_back(maxIoU);
+		matches.push_back(make_pair(ball->getConfidence(), truePositive));
 	}
+}
 
-	// Sort the detections by decreasing IoU using a index vector
-	vector<int> indices(IoUs.size());
-	for (int i = 0; i < IoUs.size(); i++) {
-		indices[i] = i;
-	}
-	sort(indices.begin(), indices.end(),
-		 [&](int a, int b) -> bool {
-		return IoUs[a] > IoUs[b];   // decreasing order
-	});
-
-	// sort tp and fp according to the sorted indices "in place"
-	vector<unsigned short> tpSorted(tp.size());
-	for (int i = 0; i < indices.size(); i++) {
-		tpSorted[i] = tp[indices[i]];
-	}
-	tp = tpSorted;
-
-	vector<unsigned short> fpSorted(fp.size());
-	for (int i = 0; i < indices.size(); i++) {
-		fpSorted[i] = fp[indices[i]];
-	}
-	fp = fpSorted;
-
-	// Compute the cumulative TP and FP
-	vector<double> cumTP(tp.size());
-	vector<double> cumFP(fp.size());
-
-	cumTP[0] = tp[0];
-	for (int i = 1; i < tp.size(); i++) {
-		cumTP[i] = cumTP[i - 1] + tp[i];
-	}
-	cumFP[0] = fp[0];
-	for (int i = 1; i < fp.size(); i++) {
-		cumFP[i] = cumFP[i - 1] + fp[i];
-	}
+/**
+ * @brief Compute the Average Precision (AP) from the matched detections of a category.
+ * The detections are sorted by decreasing confidence, the precision and the recall are computed on the cumulative
+ * true and false positives and the AP is the 11 points interpolated precision.
+ * @param matches vector of pairs (confidence, true positive), one for each detection.
+ * @param groundTruthCount number of ground truth bounding boxes of the category.
+ * @return double AP value.
+ */
+double averagePrecision(vector<pair<float, bool>> matches, int groundTruthCount) {
+	if (matches.empty())
+		return (groundTruthCount == 0) ? 1 : 0;
 
-	// Compute the precision and recall for each detection
-	vector<double> precisionVec(tp.size());
-	for (int i = 0; i < tp.size(); i++) {
-		precisionVec[i] = (cumTP[i] + cumFP[i] != 0) ? cumTP[i] / (cumTP[i] + cumFP[i]) : 0;
-	}
+	stable_sort(matches.begin(), matches.end(),
+				[](const pair<float, bool> &a, const pair<float, bool> &b) -> bool {
+		return a.first > b.first;   // decreasing order
+	});
 
-	vector<double> recallVec(tp.size());
-	for (int i = 0; i < tp.size(); i++) {
-		recallVec[i] = (groundTruthBboxesCat.size() != 0) ? cumTP[i] / groundTruthBboxesCat.size() : 1;
+	// Compute the precision and recall for each detection using the cumulative TP and FP
+	vector<double> precisionVec(matches.size());
+	vector<double> recallVec(matches.size());
+	double cumTP = 0;
+	double cumFP = 0;
+	for (int i = 0; i < matches.size(); i++) {
+		cumTP += matches[i].second ? 1 : 0;
+		cumFP += matches[i].second ? 0 : 1;
+		precisionVec[i] = cumTP / (cumTP + cumFP);
+		recallVec[i] = (groundTruthCount != 0) ? cumTP / groundTruthCount : 1;
 	}
 
 	// Compute the Average Precision
 	double AP = 0;
 	for (int t = 0; t <= 10; t++) {
 		double maxPrecision = 0;
-		for (int i = 0; i < tp.size(); i++) { // pick the maximum precision for each recall step
+		for (int i = 0; i < matches.size(); i++) { // pick the maximum precision for each recall step
 			if (recallVec[i] >= static_cast<double>(t) / 10.0 && precisionVec[i] > maxPrecision) {
 				maxPrecision = precisionVec[i];
 			}
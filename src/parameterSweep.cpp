@@ -0,0 +1,254 @@
+// Author: Michele Sprocatti
+
+#include <opencv2/core.hpp>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "detection.h"
+#include "evaluation.h"
+#include "groundTruth.h"
+
+using namespace std;
+using namespace cv;
+using namespace chrono;
+
+// values explored by the grid search, the first value of each list is the tuned default
+const vector<int> HOUGH_PARAM2_VALUES = {8, 6, 10, 12};
+const vector<int> MIN_DISTANCE_VALUES = {19, 15, 23};
+const vector<float> INVERSE_ACCUMULATOR_RESOLUTION_VALUES = {0.1, 0.5, 1};
+const vector<float> THRESHOLD_STRIPED_MAX_VALUES = {0.3, 0.2, 0.4};
+const vector<int> CANNY_THRESHOLD1_VALUES = {200, 150};
+// values of the ring template detector, explored only with it
+const vector<float> RING_WIDTH_VALUES = {1.5, 1, 2, 2.5};
+const vector<float> RING_THRESHOLD_VALUES = {20, 12, 16, 25, 30};
+
+// seed of the random search, so that the same configurations are explored in different runs
+const int DEFAULT_SEED = 123456789;
+
+// prefix of the option that selects the algorithm used to find the circles of the balls in all the configurations
+const string BALL_DETECTOR_OPTION = "--ball-detector=";
+
+/**
+ * Result of the evaluation of a configuration.
+ */
+struct SweepResult {
+	DetectionParameters params;
+	double mAP = 0;
+	double mIoU = 0;
+	double seconds = 0;
+	string error;	// empty if the evaluation succeeded.
+};
+
+/**
+ * @brief Return the values of the grid that are explored with a detector.
+ * @param values values of the grid, the first one is the default.
+ * @param explored true if the parameter is used by the detector.
+ * @return all the values if the parameter is used, only the default otherwise.
+ */
+template<typename T>
+vector<T> exploredValues(const vector<T> &values, bool explored) {
+	return explored ? values : vector<T>{values.front()};
+}
+
+/**
+ * @brief Create all the combinations of the values of the grid.
+ * The parameters that are not used by the detector keep their default, so no configuration is repeated: the
+ * ring template detector does not use the Hough parameters and the Hough detectors do not use the ring ones.
+ * @param detector algorithm used to find the circles of the balls.
+ * @return the configurations to evaluate.
+ */
+vector<DetectionParameters> gridConfigurations(BallDetectorType detector) {
+	const bool ring = detector == RING_TEMPLATE_BALL_DETECTOR;
+	vector<DetectionParameters> configurations;
+	for (int houghParam2 : exploredValues(HOUGH_PARAM2_VALUES, !ring))
+		for (int minDistance : MIN_DISTANCE_VALUES)
+			for (float resolution : exploredValues(INVERSE_ACCUMULATOR_RESOLUTION_VALUES, !ring))
+				for (float stripedMax : THRESHOLD_STRIPED_MAX_VALUES)
+					for (int canny1 : CANNY_THRESHOLD1_VALUES)
+						for (float ringWidth : exploredValues(RING_WIDTH_VALUES, ring))
+							for (float ringThreshold : exploredValues(RING_THRESHOLD_VALUES, ring)) {
+								DetectionParameters params;
+								params.balls.houghParam2 = houghParam2;
+								params.balls.minDistance = minDistance;
+								params.balls.inverseAccumulatorResolution = resolution;
+								params.classification.thresholdStripedMax = stripedMax;
+								params.table.cannyThreshold1 = canny1;
+								params.balls.ringWidth = ringWidth;
+								params.balls.ringThreshold = ringThreshold;
+								configurations.push_back(params);
+							}
+	return configurations;
+}
+
+/**
+ * @brief Sample random configurations in the ranges spanned by the grid.
+ * The first configuration is always the default one, used as reference. The parameters of the ring template are
+ * sampled only for its detector, so the configurations of the Hough detectors are the same for the same seed.
+ * @param count number of configurations.
+ * @param seed seed of the random generator.
+ * @param detector algorithm used to find the circles of the balls.
+ * @return the configurations to evaluate.
+ */
+vector<DetectionParameters> randomConfigurations(int count, int seed, BallDetectorType detector) {
+	RNG rng(seed);
+	vector<DetectionParameters> configurations = {DetectionParameters()};
+	for (int i = 1; i < count; i++) {
+		DetectionParameters params;
+		params.balls.houghParam2 = rng.uniform(5, 14);
+		params.balls.minDistance = rng.uniform(12, 27);
+		params.balls.inverseAccumulatorResolution = rng.uniform(0.1f, 1.5f);
+		params.classification.thresholdStripedMax = rng.uniform(0.15f, 0.45f);
+		params.table.cannyThreshold1 = rng.uniform(140, 231);
+		if (detector == RING_TEMPLATE_BALL_DETECTOR) {
+			params.balls.ringWidth = rng.uniform(0.8f, 3.0f);
+			params.balls.ringThreshold = rng.uniform(8.0f, 35.0f);
+		}
+		configurations.push_back(params);
+	}
+	return configurations;
+}
+
+/**
+ * @brief Write the swept parameters of a configuration as comma separated values.
+ * @param out output stream.
+ * @param params configuration.
+ */
+void writeParameters(ostream &out, const DetectionParameters &params) {
+	out << ballDetectorName(params.balls.detector) << ","
+		<< params.balls.houghParam2 << "," << params.balls.minDistance << ","
+		<< params.balls.inverseAccumulatorResolution << "," << params.classification.thresholdStripedMax << ","
+		<< params.table.cannyThreshold1 << "," << params.balls.ringWidth << "," << params.balls.ringThreshold;
+}
+
+/**
+ * @brief Check if a result is on the accuracy/latency Pareto front.
+ * A result is on the front if no other result is at the same time faster and more accurate.
+ * @param result result to check.
+ * @param results all the results.
+ * @return true if the result is on the front.
+ */
+bool isParetoOptimal(const SweepResult &result, const vector<SweepResult> &results) {
+	if (!result.error.empty())
+		return false;
+	double score = (result.mAP + result.mIoU) / 2;
+	for (const SweepResult &other : results) {
+		if (&other == &result || !other.error.empty())
+			continue;
+		double otherScore = (other.mAP + other.mIoU) / 2;
+		if (other.seconds <= result.seconds && otherScore >= score
+			&& (other.seconds < result.seconds || otherScore > score))
+			return false;
+	}
+	return true;
+}
+
+/* Sweep the detection parameters across the dataset.
+	The frames and the ground truth are decoded only once, then each configuration is evaluated on all the clips
+	in parallel. For each configuration mAP, mIoU and wall-clock time are reported, and the configurations with
+	the best accuracy/latency tradeoff are marked.
+	Usage: ParameterSweep [grid | random <count> [seed]] [--ball-detector=<name>] */
+int main(int argc, char *argv[]) {
+	BallDetectorType detector = HOUGH_BALL_DETECTOR;
+	if (argc > 1 && string(argv[argc - 1]).rfind(BALL_DETECTOR_OPTION, 0) == 0) {
+		try {
+			detector = ballDetectorFromName(string(argv[argc - 1]).substr(BALL_DETECTOR_OPTION.size()));
+		} catch (const exception &e) {
+			cout << e.what() << endl;
+			return -1;
+		}
+		argc--;
+	}
+
+	string mode = (argc > 1) ? argv[1] : "grid";
+	vector<DetectionParameters> configurations;
+	if (mode == "grid" && argc <= 2) {
+		configurations = gridConfigurations(detector);
+	} else if (mode == "random" && (argc == 3 || argc == 4)) {
+		int count = stoi(argv[2]);
+		int seed = (argc == 4) ? stoi(argv[3]) : DEFAULT_SEED;
+		if (count <= 0) {
+			cout << "The number of configurations must be positive" << endl;
+			return -1;
+		}
+		configurations = randomConfigurations(count, seed, detector);
+	} else {
+		cout << "Usage: " << argv[0] << " [grid | random <count> [seed]] [--ball-detector=<name>]" << endl;
+		return -1;
+	}
+	for (DetectionParameters &params : configurations)
+		params.balls.detector = detector;
+
+	vector<string> filename ={"/game1_clip1", "/game1_clip2", "/game1_clip3",
+								"/game1_clip4", "/game2_clip1", "/game2_clip2",
+								"/game3_clip1", "/game3_clip2", "/game4_clip1",
+								"/game4_clip2"};
+
+	// decode the frames and load the ground truth once, they are shared by all the configurations
+	vector<ClipFrames> clips(filename.size());
+	vector<string> errors(filename.size());
+	parallel_for_(Range(0, filename.size()), [&](const Range &range) {
+		for (int i = range.start; i < range.end; i++) {
+			try {
+				clips[i] = loadClipFrames("../Dataset" + filename[i]);
+				GroundTruthStore::instance().get(clips[i].clipPath, FIRST);
+			} catch (const exception &e) {
+				errors[i] = e.what();
+			}
+		}
+	});
+	for (int i = 0; i < filename.size(); i++) {
+		if (!errors[i].empty()) {
+			cout << "Error loading " << filename[i] << ": " << errors[i] << endl;
+			return -1;
+		}
+	}
+
+	filesystem::path outputPath = filesystem::path("../Output") / "parameter_sweep.csv";
+	filesystem::create_directories(outputPath.parent_path());
+	ofstream csv(outputPath);
+	csv << "ballDetector,houghParam2,minDistance,inverseAccumulatorResolution,thresholdStripedMax,cannyThreshold1,ringWidth,ringThreshold,mAP,mIoU,seconds,pareto" << endl;
+
+	vector<SweepResult> results(configurations.size());
+	for (int i = 0; i < configurations.size(); i++) {
+		SweepResult &result = results[i];
+		result.params = configurations[i];
+
+		vector<EvaluationResult> clipResults;
+		time_point<steady_clock> start = steady_clock::now();
+		try {
+			EvaluationResult evaluation = evaluateDataset(clips, result.params, clipResults);
+			result.mAP = evaluation.mAP();
+			result.mIoU = evaluation.mIoU();
+		} catch (const exception &e) {
+			result.error = e.what();
+		}
+		result.seconds = duration<double>(steady_clock::now() - start).count();
+
+		cout << "[" << i + 1 << "/" << configurations.size() << "] ";
+		writeParameters(cout, result.params);
+		if (result.error.empty())
+			cout << " -> mAP: " << result.mAP << " mIoU: " << result.mIoU << " time: " << result.seconds << " s" << endl;
+		else
+			cout << " -> failed: " << result.error << endl;
+	}
+
+	cout << "-------------- Best tradeoffs --------------" << endl;
+	for (const SweepResult &result : results) {
+		bool pareto = isParetoOptimal(result, results);
+		if (result.error.empty()) {
+			writeParameters(csv, result.params);
+			csv << "," << result.mAP << "," << result.mIoU << "," << result.seconds << "," << pareto << endl;
+		}
+		if (pareto) {
+			writeParameters(cout, result.params);
+			cout << " -> mAP: " << result.mAP << " mIoU: " << result.mIoU << " time: " << result.seconds << " s" << endl;
+		}
+	}
+	cout << "Results saved in " << outputPath.string() << endl;
+
+	return 0;
+}
@@ -0,0 +1,266 @@
+// Author: Michele Sprocatti
+
+#include "poolAnalyzer.h"
+
+#include <stdexcept>
+#include "profiler.h"
+#include "util.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ * @brief Constructor.
+ * @param config configuration of the analysis.
+ * @throw invalid_argument if the maximum tracking step is less than 1 or the color model interval is negative.
+ */
+PoolAnalyzer::PoolAnalyzer(const PoolAnalyzerConfig &config /*= PoolAnalyzerConfig()*/) {
+	if (config.maxTrackingStep < 1)
+		throw invalid_argument("The maximum tracking step must be at least 1");
+	if (config.colorModelInterval < 0)
+		throw invalid_argument("The color model interval must not be negative");
+	config_ = config;
+
+	renderedBalls_ = makePtr<vector<Ball>>();
+	segmentedBalls_ = makePtr<vector<Ball>>();
+	singleFrame_.resize(1);
+	frameCount_ = 0;
+}
+
+/**
+ * @brief Start the analysis of a clip from its first frame.
+ * The table and the balls are detected and segmented, then the transformation to the minimap is computed and the
+ * tracker, the events, the activity monitor and the color model are initialized. The buffers of the previous clip are reused.
+ * @param firstFrame first frame of the clip, BGR format requested.
+ * @param fps frames per second of the clip.
+ * @return the result of the first frame.
+ * @throw invalid_argument if the frame is empty.
+ */
+const FrameResult &PoolAnalyzer::init(const Mat &firstFrame, double fps) {
+	if (firstFrame.empty())
+		throw invalid_argument("Empty frame in input");
+
+	//DETECT AND SEGMENT TABLE
+	// the frame is converted to HSV once for all the detections
+	colors_.analyze(firstFrame);
+	Vec<Point2f, 4> tableCorners;
+	Vec2b colorTable;
+	detectTable(firstFrame, colors_, tableCorners, colorTable, config_.detection);
+	table_ = Table(tableCorners, colorTable);
+
+	//DETECT AND SEGMENT BALLS
+	// the table is static, its segmentation is cached and reused for the following segmentations;
+	// the balls are detected first, so that the cache does not keep their pixels as background
+	detectBalls(firstFrame, colors_, table_, config_.detection);
+	segmenter_.init(firstFrame, colors_, table_, table_.ballsPtr());
+	segmenter_.segment(table_.ballsPtr()).copyTo(segmented_);
+
+	//TRANSFORMATION
+	Vec<Point2f, 4> imgCorners = table_.getBoundaries();
+	table_.setTransform(computeTransformation(segmented_, imgCorners));
+	table_.setBoundaries(imgCorners);
+	transform_ = table_.getTransform();
+
+	//MINIMAP, TRACKER, EVENTS AND ACTIVITY
+	// they are created for the first clip and reset for the following ones
+	emptyMinimap().copyTo(minimapWithTrack_);
+	if (tracker_ == nullptr) {
+		tracker_ = makePtr<FrameSkippingTracker>(table_.ballsPtr(), config_.maxTrackingStep);
+		events_ = makePtr<EventDetector>(table_.ballsPtr(), transform_, fps);
+		motion_ = makePtr<BallMotionEstimator>(fps);
+		activity_ = makePtr<SceneActivityMonitor>(table_.getBoundaries(), firstFrame.size());
+		if (config_.colorModelInterval > 0)
+			colorModel_ = makePtr<TableColorModel>(table_.getBoundaries(), firstFrame.size());
+	} else {
+		tracker_->reset(table_.ballsPtr(), config_.maxTrackingStep);
+		events_->reset(table_.ballsPtr(), transform_, fps);
+		motion_->reset(fps);
+		activity_->reset(table_.getBoundaries(), firstFrame.size());
+		if (colorModel_ != nullptr)
+			colorModel_->reset(table_.getBoundaries(), firstFrame.size());
+	}
+
+	frameCount_ = 1;
+	results_.resize(1);
+	FrameResult &result = results_[0];
+	result.frame = frameCount_;
+	result.balls = *table_.ballsPtr();
+	computeMinimapPositions(transform_, table_.ballsPtr(), result.positions);
+	result.events = events_->update(frameCount_, result.positions);
+	result.kinematics = motion_->update(frameCount_, result.positions, *table_.ballsPtr());
+	result.kinematicsFrame = motion_->getLaggedFrame();
+	drawMinimap(minimapWithTrack_, result.positions, table_.ballsPtr(), result.minimap);
+	createOutputImage(firstFrame, result.minimap, result.output);
+	result.atRest = false;
+
+	tracker_->track(firstFrame, 1, interpolated_);
+	activity_->update(firstFrame);
+	return result;
+}
+
+/**
+ * @brief Compute the minimap, the events, the motion of the balls, the output image and the activity of a frame.
+ * Every colorModelInterval frames the color model of the table is updated with the frame.
+ * @param frame frame to render.
+ * @param balls balls in the frame.
+ * @param result output result of the frame.
+ */
+void PoolAnalyzer::render(const Mat &frame, Ptr<vector<Ball>> balls, FrameResult &result) {
+	result.frame = frameCount_;
+	computeMinimapPositions(transform_, balls, result.positions);
+	result.balls = *balls;
+	{
+		ScopedTimer eventsTimer("events");
+		result.events = events_->update(frameCount_, result.positions);
+	}
+	{
+		ScopedTimer motionTimer("motion");
+		result.kinematics = motion_->update(frameCount_, result.positions, *balls);
+		result.kinematicsFrame = motion_->getLaggedFrame();
+	}
+	drawMinimap(minimapWithTrack_, result.positions, balls, result.minimap);
+	{
+		ScopedTimer outputTimer("createOutputImage");
+		createOutputImage(frame, result.minimap, result.output);
+	}
+	{
+		ScopedTimer activityTimer("activity");
+		result.atRest = activity_->update(frame);
+	}
+	if (colorModel_ != nullptr && frameCount_ % config_.colorModelInterval == 0) {
+		ScopedTimer colorModelTimer("colorModel");
+		colorModel_->update(frame, table_, *balls);
+	}
+}
+
+/**
+ * @brief Analyze the next frame of the clip.
+ * The frame is passed to the analysis of many frames through a vector owned by the analyzer, without allocations.
+ * @param frame frame to analyze.
+ * @return the result of the frame, valid until the next call.
+ * @throw invalid_argument if init has not been called.
+ */
+const FrameResult &PoolAnalyzer::process(const Mat &frame) {
+	// the header of the frame is kept only during the call
+	singleFrame_[0] = frame;
+	const FrameResult &result = process(singleFrame_).front();
+	singleFrame_[0].release();
+	return result;
+}
+
+/**
+ * @brief Analyze the next frames of the clip, tracking only the last one.
+ * The balls are tracked in the last frame and interpolated in the others, then every frame is rendered in order.
+ * @param frames frames from the previous tracked frame, in order; they should be getStep() frames.
+ * @return the result of each frame, valid until the next call.
+ * @throw invalid_argument if init has not been called or frames is empty.
+ */
+const vector<FrameResult> &PoolAnalyzer::process(const vector<Mat> &frames) {
+	if (tracker_ == nullptr)
+		throw invalid_argument("The analyzer has not been initialized");
+	if (frames.empty())
+		throw invalid_argument("Empty vector of frames in input");
+
+	const int n = frames.size();
+	tracker_->track(frames.back(), n, interpolated_);
+	results_.resize(n);
+	for (int j = 0; j < n; j++) {
+		++frameCount_;
+		Profiler::instance().setFrame(frameCount_);
+		ScopedTimer frameTimer("frame");
+		if (j < n - 1) {
+			*renderedBalls_ = interpolated_[j];
+			render(frames[j], renderedBalls_, results_[j]);
+		} else {
+			render(frames[j], table_.ballsPtr(), results_[j]);
+		}
+	}
+	return results_;
+}
+
+/**
+ * @brief Return the number of frames to pass to the next call of process.
+ * @return the current tracking step, 1 if init has not been called.
+ */
+int PoolAnalyzer::getStep() const {
+	return (tracker_ == nullptr) ? 1 : tracker_->getStep();
+}
+
+/**
+ * @brief Finish the analysis of the clip by detecting the balls in its last frame.
+ * The tracked balls are replaced by the detected ones and they are segmented on the cached segmentation of the table,
+ * which is computed again on the last frame if the color model changed the color bounds of the table.
+ * @param lastFrame last frame of the clip.
+ * @throw invalid_argument if init has not been called.
+ */
+void PoolAnalyzer::finish(const Mat &lastFrame) {
+	if (tracker_ == nullptr)
+		throw invalid_argument("The analyzer has not been initialized");
+
+	colors_.analyze(lastFrame);
+	table_.clearBalls();
+	detectBalls(lastFrame, colors_, table_, config_.detection);
+	if (!segmenter_.isUpToDate(table_))
+		segmenter_.init(lastFrame, colors_, table_, table_.ballsPtr());
+	segmenter_.segment(table_.ballsPtr()).copyTo(segmented_);
+}
+
+/**
+ * @brief Return the table of the clip with the current balls.
+ * @return the table.
+ */
+Table &PoolAnalyzer::getTable() {
+	return table_;
+}
+
+/**
+ * @brief Return the segmentation of the first frame, or of the last frame after finish.
+ * @return the segmented image.
+ */
+const Mat &PoolAnalyzer::getSegmentation() const {
+	return segmented_;
+}
+
+/**
+ * @brief Return the estimator of the motion of the balls of the clip.
+ * @return the estimator.
+ * @throw invalid_argument if init has not been called.
+ */
+const BallMotionEstimator &PoolAnalyzer::getMotion() const {
+	if (motion_ == nullptr)
+		throw invalid_argument("The analyzer has not been initialized");
+	return *motion_;
+}
+
+/**
+ * @brief Segment the balls of a frame on the cached segmentation of the table.
+ * Only the regions of the balls that changed since the previous segmentation are drawn again. If the color model
+ * changed the color bounds of the table since the cached segmentation, the table is segmented again on frame.
+ * The balls are passed explicitly since in a skipped frame they are the interpolated ones of its result, not the
+ * ones of the table.
+ * @param frame current frame, the table is segmented again on it if its color changed.
+ * @param balls balls in the frame.
+ * @return the segmented image, valid until the next call. It must not be modified.
+ * @throw invalid_argument if init has not been called.
+ */
+const Mat &PoolAnalyzer::segmentCurrentBalls(const Mat &frame, const vector<Ball> &balls) {
+	if (tracker_ == nullptr)
+		throw invalid_argument("The analyzer has not been initialized");
+	*segmentedBalls_ = balls;
+	if (!segmenter_.isUpToDate(table_)) {
+		colors_.analyze(frame);
+		segmenter_.init(frame, colors_, table_, segmentedBalls_);
+	}
+	return segmenter_.segment(segmentedBalls_);
+}
+
+/**
+ * @brief Return the detector of the events of the clip.
+ * @return the detector.
+ * @throw invalid_argument if init has not been called.
+ */
+const EventDetector &PoolAnalyzer::getEvents() const {
+	if (events_ == nullptr)
+		throw invalid_argument("The analyzer has not been initialized");
+	return *events_;
+}
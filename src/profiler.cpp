@@ -0,0 +1,130 @@
+// Author: Michele Sprocatti
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+using namespace std;
+using namespace chrono;
+
+/**
+ * @brief Constructor of a disabled profiler.
+ */
+Profiler::Profiler() : enabled_(false), frame_(0), origin_(steady_clock::now()) {
+}
+
+/**
+ * @brief Return the profiler shared by the whole program.
+ * @return the profiler.
+ */
+Profiler &Profiler::instance() {
+	static Profiler profiler;
+	return profiler;
+}
+
+/**
+ * @brief Enable or disable the recording of the intervals.
+ * When the profiler is enabled the origin of the trace is reset.
+ * @param enabled true to record the intervals.
+ */
+void Profiler::setEnabled(bool enabled) {
+	lock_guard<mutex> lock(mutex_);
+	if (enabled && !enabled_)
+		origin_ = steady_clock::now();
+	enabled_.store(enabled);
+}
+
+/**
+ * @brief Set the frame that is currently processed, it is associated with the next intervals.
+ * @param frame number of the frame.
+ */
+void Profiler::setFrame(int frame) {
+	frame_.store(frame, memory_order_relaxed);
+}
+
+/**
+ * @brief Record an interval.
+ * @param stage name of the stage, it must be a string literal.
+ * @param start start of the interval.
+ * @param end end of the interval.
+ */
+void Profiler::record(const char *stage, steady_clock::time_point start, steady_clock::time_point end) {
+	lock_guard<mutex> lock(mutex_);
+	map<thread::id, int>::iterator it = threads_.find(this_thread::get_id());
+	if (it == threads_.end())
+		it = threads_.emplace(this_thread::get_id(), threads_.size()).first;
+
+	intervals_.push_back({stage, start, end - start, it->second, frame_.load(memory_order_relaxed)});
+}
+
+/**
+ * @brief Compute a percentile of sorted values with the nearest rank method.
+ * @param sorted values sorted in ascending order, not empty.
+ * @param percentile percentile between 0 and 100.
+ * @return the value of the percentile.
+ */
+double percentileOf(const vector<double> &sorted, double percentile) {
+	int rank = static_cast<int>(percentile / 100 * sorted.size() + 0.5);
+	rank = min(max(rank, 1), static_cast<int>(sorted.size()));
+	return sorted[rank - 1];
+}
+
+/**
+ * @brief Print the number of calls and the 50th, 95th and 99th percentile of the duration of each stage.
+ * @param out output stream.
+ */
+void Profiler::printSummary(ostream &out) {
+	map<string, vector<double>> durations;
+	{
+		lock_guard<mutex> lock(mutex_);
+		for (const Interval &interval : intervals_)
+			durations[interval.stage].push_back(duration<double, milli>(interval.duration).count());
+	}
+
+	out << left << setw(40) << "stage" << right << setw(8) << "calls"
+		<< setw(12) << "p50 [ms]" << setw(12) << "p95 [ms]" << setw(12) << "p99 [ms]" << endl;
+	for (pair<const string, vector<double>> &stage : durations) {
+		vector<double> &values = stage.second;
+		sort(values.begin(), values.end());
+		out << left << setw(40) << stage.first << right << setw(8) << values.size() << fixed << setprecision(3)
+			<< setw(12) << percentileOf(values, 50) << setw(12) << percentileOf(values, 95)
+			<< setw(12) << percentileOf(values, 99) << endl;
+	}
+}
+
+/**
+ * @brief Save the recorded intervals as a timeline in the Chrome trace JSON format.
+ * Each interval is a complete event with the frame as argument, the times are in microseconds from the origin.
+ * @param path path of the output file.
+ * @throw invalid_argument if the file cannot be written.
+ */
+void Profiler::writeTrace(const string &path) {
+	ofstream file(path);
+	if (!file.is_open())
+		throw invalid_argument("Cannot write trace file " + path);
+
+	lock_guard<mutex> lock(mutex_);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << endl;
+	file << fixed << setprecision(3);
+	for (size_t i = 0; i < intervals_.size(); i++) {
+		const Interval &interval = intervals_[i];
+		file << "{\"name\":\"" << interval.stage << "\",\"cat\":\"pipeline\",\"ph\":\"X\""
+			 << ",\"ts\":" << duration<double, micro>(interval.start - origin_).count()
+			 << ",\"dur\":" << duration<double, micro>(interval.duration).count()
+			 << ",\"pid\":0,\"tid\":" << interval.thread
+			 << ",\"args\":{\"frame\":" << interval.frame << "}}"
+			 << (i + 1 < intervals_.size() ? "," : "") << endl;
+	}
+	file << "]}" << endl;
+}
+
+/**
+ * @brief Remove all the recorded intervals.
+ */
+void Profiler::clear() {
+	lock_guard<mutex> lock(mutex_);
+	intervals_.clear();
+}
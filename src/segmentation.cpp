@@ -13,27 +13,41 @@ using namespace cv;
 using namespace std;
 
 /**
- * @brief segment the table in the input image: To do this firstly the image is clustered using kmeans
- * with 2 clusters,Then two masks are created: one using the corners of the table to isolate it
- * and one using the color of it. Then all the information is put together to create the output image.
+ * @brief segment the table in the input image.
+ * The image is analyzed only for this segmentation, use the overload with the color analysis to share it.
  * @param frame input image.
  * @param table initialized object containing information about the table in the input image.
  * @param segmented output image where the table is green.
  * @throw invalid_argument if frame is empty or if frame has less than 3 channels.
  */
 void segmentTable(const Mat &frame, const Table& table, Mat& segmented){
+	FrameColorAnalysis colors = FrameColorAnalysis(frame);
+	segmentTable(frame, colors, table, segmented);
+}
+
+/**
+ * @brief segment the table in the input image, using the color analysis of the image: To do this firstly the
+ * image is clustered using kmeans with 2 clusters,Then two masks are created: one using the corners of the table
+ * to isolate it and one using the color of it. Then all the information is put together to create the output image.
+ * @param frame input image.
+ * @param colors color analysis of frame, shared with the other functions working on the same frame.
+ * @param table initialized object containing information about the table in the input image.
+ * @param segmented output image where the table is green.
+ * @throw invalid_argument if frame is empty or if frame has less than 3 channels or if colors is not the analysis of frame.
+ */
+void segmentTable(const Mat &frame, FrameColorAnalysis &colors, const Table& table, Mat& segmented){
 
 	if(frame.empty())
 		throw invalid_argument("Empty image in input");
 
 	if(frame.channels() != 3)
 		throw invalid_argument("Invalid number of channels for the input image");
+	colors.checkFrame(frame);
 
 	Mat polyImage = Mat::zeros(frame.size(), CV_8UC1);
 	vector<Point> tableCornersInt;
 
 	// table properties
-	Vec2b colorTable = table.getColorRange();
 	Vec<Point2f, 4> tableCorners = table.getBoundaries();
 
 	// needed otherwise error
@@ -43,11 +57,8 @@ void segmentTable(const Mat &frame, const Table& table, Mat& segmented){
 	fillConvexPoly(polyImage, tableCornersInt, 255);
 	//imshow("poly", polyImage);
 
-	Mat clustered, HSVimg, mask;
-	cvtColor(frame, HSVimg, COLOR_BGR2HSV);
-
-	inRange(HSVimg, Scalar(colorTable[0], S_CHANNEL_COLOR_THRESHOLD, V_CHANNEL_COLOR_THRESHOLD),
-				Scalar(colorTable[1], 255, 255), mask);
+	Mat clustered;
+	const Mat &mask = colors.tableMask(table, S_CHANNEL_COLOR_THRESHOLD, V_CHANNEL_COLOR_THRESHOLD);
 	//imshow("mask", mask);
 	const vector<Vec3b> COLORS = {
 		Vec3b(0, 0, 0),
@@ -118,3 +129,122 @@ void segmentBalls(const Mat &frame, Ptr<vector<Ball>> balls, Mat& segmented){
 
 	}
 }
+
+/**
+ * @brief Return the region of the segmented image that can be changed by drawing a ball.
+ * It is the region of the disk drawn by segmentBalls, with one pixel of margin for the rounding of its center.
+ * @param ball ball to draw.
+ * @param size size of the segmented image.
+ * @return the region, clipped to the image.
+ */
+Rect ballRegion(const Ball &ball, const Size &size) {
+	Rect b = ball.getBbox();
+	Rect region = Rect(b.x - 1, b.y - 1, b.width + 3, b.width + 3);
+	return region & Rect(Point(0, 0), size);
+}
+
+/**
+ * @brief Segment the table in a frame and cache the result.
+ * The segmentation of the table is the one of segmentTable. The pixels of the balls in the frame are not of the
+ * color of the cloth, so segmentTable marks them as background: their disks inside the table are marked as playing
+ * field, otherwise the cache would keep holes where the balls were when they move.
+ * @param frame input image.
+ * @param colors color analysis of frame, shared with the other functions working on the same frame.
+ * @param table initialized object containing information about the table in the input image.
+ * @param balls pointer to a vector of the balls in the image, their disks are marked as playing field.
+ * @throw invalid_argument if frame is empty or if frame has less than 3 channels or if colors is not the analysis of frame
+ * 			or if balls is nullptr.
+ */
+void IncrementalSegmenter::init(const Mat &frame, FrameColorAnalysis &colors, const Table &table, Ptr<vector<Ball>> balls) {
+	if(balls == nullptr)
+		throw invalid_argument("Null pointer");
+	segmentTable(frame, colors, table, tableSegmentation_);
+
+	// the disks are drawn with the margin of ballRegion and only inside the table
+	Vec<Point2f, 4> tableCorners = table.getBoundaries();
+	Mat polygon, disk;
+	vector<Point> regionCorners(4);
+	for(const Ball &ball : *balls) {
+		if(!ball.getVisibility())
+			continue;
+		Rect region = ballRegion(ball, tableSegmentation_.size());
+		if(region.empty())
+			continue;
+		for(int i = 0; i < 4; i++)
+			regionCorners[i] = Point(static_cast<int>(tableCorners[i].x), static_cast<int>(tableCorners[i].y)) - region.tl();
+		polygon = Mat::zeros(region.size(), CV_8UC1);
+		fillConvexPoly(polygon, regionCorners, 255);
+		disk = Mat::zeros(region.size(), CV_8UC1);
+		Rect b = ball.getBbox();
+		float radius = b.width / 2.0;
+		circle(disk, Point(b.tl().x + radius, b.tl().y + radius) - region.tl(), cvCeil(radius) + 1, 255, FILLED);
+		tableSegmentation_(region).setTo(PLAYING_FIELD_BGR_COLOR, disk & polygon);
+	}
+	tableSegmentation_.copyTo(segmented_);
+	drawnRegions_.clear();
+	drawnBalls_.clear();
+	hasColorBounds_ = table.hasColorBounds();
+	if(hasColorBounds_)
+		table.getColorBounds(colorLower_, colorUpper_);
+}
+
+/**
+ * @brief Segment the balls on the cached segmentation of the table.
+ * If the balls are the same of the previous call the previous segmentation is returned, otherwise the regions of
+ * the previous balls are restored from the cache and all the balls are drawn again, since the disks can overlap.
+ * @param balls pointer to a vector of the balls in the image, it can be empty.
+ * @return the segmented image, valid until the next call. It must not be modified.
+ * @throw invalid_argument if init has not been called or if balls is nullptr.
+ */
+const Mat &IncrementalSegmenter::segment(Ptr<vector<Ball>> balls) {
+	if(tableSegmentation_.empty())
+		throw invalid_argument("The segmentation of the table has not been computed");
+
+	if(balls == nullptr)
+		throw invalid_argument("Null pointer");
+
+	bool changed = balls->size() != drawnBalls_.size();
+	for(int i = 0; !changed && i < balls->size(); i++) {
+		const Ball &ball = balls->at(i), &drawn = drawnBalls_[i];
+		changed = ball.getBbox() != drawn.getBbox() || ball.getCategory() != drawn.getCategory()
+				|| ball.getVisibility() != drawn.getVisibility();
+	}
+	if(!changed)
+		return segmented_;
+
+	for(const Rect &region : drawnRegions_)
+		tableSegmentation_(region).copyTo(segmented_(region));
+
+	drawnRegions_.clear();
+	for(const Ball &ball : *balls)
+		if(ball.getVisibility())
+			drawnRegions_.push_back(ballRegion(ball, segmented_.size()));
+	if(!balls->empty())
+		segmentBalls(segmented_, balls, segmented_);
+	drawnBalls_ = *balls;
+	return segmented_;
+}
+
+/**
+ * @brief Return if the cached segmentation has been computed with the current color of the table.
+ * The color of the table changes only through its HSV bounds, which are compared with the ones used by init.
+ * @param table table whose color is compared.
+ * @return true if init has been called and the color bounds of the table did not change since then.
+ */
+bool IncrementalSegmenter::isUpToDate(const Table &table) const {
+	if(tableSegmentation_.empty() || table.hasColorBounds() != hasColorBounds_)
+		return false;
+	if(!hasColorBounds_)
+		return true;
+	Vec3b lower, upper;
+	table.getColorBounds(lower, upper);
+	return lower == colorLower_ && upper == colorUpper_;
+}
+
+/**
+ * @brief Return the cached segmentation of the table without the balls.
+ * @return the segmented image.
+ */
+const Mat &IncrementalSegmenter::getTableSegmentation() const {
+	return tableSegmentation_;
+}
@@ -0,0 +1,229 @@
+// Author: Michele Sprocatti
+
+#include "sharedFrames.h"
+
+#include <opencv2/core.hpp>
+#include <chrono>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SHARED_FRAMES_POSIX
+#endif
+
+using namespace std;
+using namespace cv;
+
+// interval between two checks of the state of the buffer while waiting
+const chrono::microseconds SHARED_FRAMES_POLL_INTERVAL = chrono::microseconds(200);
+
+/**
+ * @brief Return the offset of the first slot from the beginning of the shared memory.
+ * @return the offset in bytes.
+ */
+size_t sharedFramesSlotsOffset() {
+	return (sizeof(SharedFramesHeader) + SHARED_FRAMES_ALIGNMENT - 1) / SHARED_FRAMES_ALIGNMENT * SHARED_FRAMES_ALIGNMENT;
+}
+
+/**
+ * @brief Constructor, it creates the shared memory object.
+ * A previous object with the same name, left by a producer that did not terminate correctly, is replaced.
+ * @param name name of the shared memory object, it must start with '/'.
+ * @param frameSize size of the frames.
+ * @param type OpenCV type of the frames.
+ * @param fps frames per second of the stream.
+ * @param slotCount number of slots.
+ * @throw invalid_argument if the parameters are not valid.
+ * @throw runtime_error if the shared memory cannot be created.
+ */
+SharedFrameSink::SharedFrameSink(const string &name, Size frameSize, int type, double fps, int slotCount) {
+	if (name.empty() || name[0] != '/')
+		throw invalid_argument("The name of the shared memory must start with '/'");
+	if (frameSize.empty() || slotCount < 1)
+		throw invalid_argument("Invalid size of the frames or number of slots");
+
+	name_ = name;
+	uint64_t frameBytes = static_cast<uint64_t>(frameSize.area()) * CV_ELEM_SIZE(type);
+	uint64_t slotSize = (frameBytes + SHARED_FRAMES_ALIGNMENT - 1) / SHARED_FRAMES_ALIGNMENT * SHARED_FRAMES_ALIGNMENT;
+	size_ = sharedFramesSlotsOffset() + slotSize * slotCount;
+
+#ifdef SHARED_FRAMES_POSIX
+	shm_unlink(name.c_str());
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0)
+		throw runtime_error("Cannot create shared memory " + name);
+	if (ftruncate(fd, size_) != 0) {
+		::close(fd);
+		shm_unlink(name.c_str());
+		throw runtime_error("Cannot resize shared memory " + name);
+	}
+	void *address = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (address == MAP_FAILED) {
+		shm_unlink(name.c_str());
+		throw runtime_error("Cannot map shared memory " + name);
+	}
+
+	header_ = new (address) SharedFramesHeader();
+	slots_ = static_cast<unsigned char *>(address) + sharedFramesSlotsOffset();
+	header_->version = SHARED_FRAMES_VERSION;
+	header_->rows = frameSize.height;
+	header_->cols = frameSize.width;
+	header_->type = type;
+	header_->slotCount = slotCount;
+	header_->slotSize = slotSize;
+	header_->fps = fps;
+	header_->written.store(0);
+	header_->released.store(0);
+	header_->closed.store(0);
+	header_->attached.store(0);
+
+	// the magic number is written last, so the consumer never sees a partially initialized header
+	atomic_thread_fence(memory_order_release);
+	header_->magic = SHARED_FRAMES_MAGIC;
+#else
+	throw runtime_error("Shared memory is not supported on this platform");
+#endif
+}
+
+/**
+ * @brief Destructor, it closes the stream and removes the shared memory object.
+ * The consumer can still read the published frames, the memory is freed when it detaches.
+ */
+SharedFrameSink::~SharedFrameSink() {
+#ifdef SHARED_FRAMES_POSIX
+	close();
+	munmap(header_, size_);
+	shm_unlink(name_.c_str());
+#endif
+}
+
+/**
+ * @brief Wait until a consumer is attached to the buffer.
+ * The shared memory object is removed when the producer terminates, so a short stream must not end before the
+ * consumer has opened it.
+ */
+void SharedFrameSink::waitConsumer() {
+	while (!header_->attached.load(memory_order_acquire))
+		this_thread::sleep_for(SHARED_FRAMES_POLL_INTERVAL);
+}
+
+/**
+ * @brief Wait for a free slot and return it, the next frame must be written in it.
+ * A slot is free when the frame stored in it has been released by the consumer.
+ * @return a header on the memory of the slot, without copies.
+ */
+Mat SharedFrameSink::acquire() {
+	uint64_t written = header_->written.load(memory_order_relaxed);
+	while (written - header_->released.load(memory_order_acquire) >= header_->slotCount)
+		this_thread::sleep_for(SHARED_FRAMES_POLL_INTERVAL);
+
+	return Mat(header_->rows, header_->cols, header_->type, slots_ + (written % header_->slotCount) * header_->slotSize);
+}
+
+/**
+ * @brief Publish the frame written in the acquired slot.
+ */
+void SharedFrameSink::publish() {
+	header_->written.fetch_add(1, memory_order_release);
+}
+
+/**
+ * @brief Signal to the consumer that there are no more frames.
+ */
+void SharedFrameSink::close() {
+	header_->closed.store(1, memory_order_release);
+}
+
+/**
+ * @brief Constructor, it attaches to the shared memory object created by the producer.
+ * @param name name of the shared memory object, it must start with '/'.
+ * @param retainedFrames number of returned frames that remain valid.
+ * @throw invalid_argument if the buffer has not enough slots for the retained frames.
+ * @throw runtime_error if the shared memory cannot be opened or it is not a valid buffer.
+ */
+SharedFrameSource::SharedFrameSource(const string &name, int retainedFrames) {
+	next_ = 0;
+	retainedFrames_ = retainedFrames;
+
+#ifdef SHARED_FRAMES_POSIX
+	int fd = shm_open(name.c_str(), O_RDWR, 0);
+	if (fd < 0)
+		throw runtime_error("Cannot open shared memory " + name);
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size < static_cast<off_t>(sharedFramesSlotsOffset())) {
+		::close(fd);
+		throw runtime_error("Invalid shared memory " + name);
+	}
+	size_ = fileStat.st_size;
+	void *address = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (address == MAP_FAILED)
+		throw runtime_error("Cannot map shared memory " + name);
+
+	header_ = static_cast<SharedFramesHeader *>(address);
+	slots_ = static_cast<unsigned char *>(address) + sharedFramesSlotsOffset();
+
+	bool valid = header_->magic == SHARED_FRAMES_MAGIC;
+	atomic_thread_fence(memory_order_acquire);
+	valid = valid && header_->version == SHARED_FRAMES_VERSION && header_->type == CV_8UC3
+			&& header_->rows > 0 && header_->cols > 0 && header_->slotCount > 0
+			&& header_->slotSize >= static_cast<uint64_t>(header_->rows) * header_->cols * CV_ELEM_SIZE(header_->type)
+			&& sharedFramesSlotsOffset() + header_->slotSize * header_->slotCount <= size_;
+	if (!valid) {
+		munmap(address, size_);
+		throw runtime_error("Shared memory " + name + " is not a valid frame buffer");
+	}
+	if (header_->slotCount <= static_cast<uint32_t>(retainedFrames)) {
+		munmap(address, size_);
+		throw invalid_argument("The frame buffer needs more slots than the retained frames");
+	}
+	header_->attached.store(1, memory_order_release);
+#else
+	throw runtime_error("Shared memory is not supported on this platform");
+#endif
+}
+
+/**
+ * @brief Destructor, it detaches from the shared memory.
+ */
+SharedFrameSource::~SharedFrameSource() {
+#ifdef SHARED_FRAMES_POSIX
+	munmap(header_, size_);
+#endif
+}
+
+/**
+ * @brief Wait for the next frame.
+ * Before waiting, the frames older than the retained ones are released, so the producer can reuse their slots.
+ * @param frame output header on the memory of the frame, without copies.
+ * @return true if a frame has been read, false if the producer has no more frames.
+ */
+bool SharedFrameSource::read(Mat &frame) {
+	// the frame that is going to be read replaces the oldest retained one
+	if (next_ + 1 > static_cast<uint64_t>(retainedFrames_))
+		header_->released.store(next_ + 1 - retainedFrames_, memory_order_release);
+
+	while (header_->written.load(memory_order_acquire) <= next_) {
+		if (header_->closed.load(memory_order_acquire) && header_->written.load(memory_order_acquire) <= next_)
+			return false;
+		this_thread::sleep_for(SHARED_FRAMES_POLL_INTERVAL);
+	}
+
+	frame = Mat(header_->rows, header_->cols, header_->type, slots_ + (next_ % header_->slotCount) * header_->slotSize);
+	next_++;
+	return true;
+}
+
+/**
+ * @brief Return the frames per second of the stream.
+ * @return the frames per second.
+ */
+double SharedFrameSource::getFps() const {
+	return header_->fps;
+}
@@ -0,0 +1,66 @@
+// Author: Michele Sprocatti
+
+#include <opencv2/videoio.hpp>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "sharedFrames.h"
+
+using namespace std;
+using namespace cv;
+
+// default number of slots of the shared buffer, it must be greater than the frames retained by the consumer
+const int DEFAULT_SLOTS = 16;
+
+/* Local producer of frames for 8BallPool: it decodes a video directly into the slots of a ring buffer in POSIX shared
+ memory, so the consumer started with shm:<name> reads the frames without copies. When the video ends the stream
+ is closed and the shared memory is removed. */
+int main(int argc, char *argv[]) {
+	if (argc < 3 || argc > 4) {
+		cout << "Usage: " << argv[0] << " <video> <name> [slots]" << endl;
+		return -1;
+	}
+	string name = string(argv[2]);
+	if (name.empty() || name[0] != '/')
+		name = "/" + name;
+	int slots = (argc > 3) ? stoi(argv[3]) : DEFAULT_SLOTS;
+
+	VideoCapture vid = VideoCapture(argv[1]);
+	Mat first;
+	if (!vid.isOpened() || !vid.read(first) || first.type() != CV_8UC3) {
+		cout << "Error opening video file" << endl;
+		return -1;
+	}
+
+	try {
+		SharedFrameSink sink = SharedFrameSink(name, first.size(), first.type(), vid.get(CAP_PROP_FPS), slots);
+		cout << "Waiting for the consumer on " << name << endl;
+		sink.waitConsumer();
+		cout << "Publishing " << argv[1] << endl;
+
+		Mat slot = sink.acquire();
+		first.copyTo(slot);
+		sink.publish();
+		int frameCount = 1;
+
+		// the frames after the first are decoded in place: the decoder writes in the slot since it has the same
+		// size and type of the frame, so the slot header must not be reallocated
+		slot = sink.acquire();
+		while (vid.read(slot)) {
+			if (slot.data != sink.acquire().data) {
+				cout << "Error: the frames of the video have different sizes" << endl;
+				return -1;
+			}
+			sink.publish();
+			frameCount++;
+			slot = sink.acquire();
+		}
+		sink.close();
+		cout << "Frames published: " << frameCount << endl;
+	} catch (const exception &e) {
+		cout << "Error: " << e.what() << endl;
+		return -1;
+	}
+	return 0;
+}
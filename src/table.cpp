@@ -32,6 +32,28 @@ Vec2b Table::getColorRange() const {
 	return colorRange_;
 }
 
+/**
+ * @brief Return true if the color of the Table is described by HSV bounds, for example by an adaptive color model.
+ * @return true if the bounds are set.
+ */
+bool Table::hasColorBounds() const {
+	return hasColorBounds_;
+}
+
+/**
+ * @brief Return the HSV bounds of the color of the Table.
+ * @param lower output lower bound of the H, S and V channels.
+ * @param upper output upper bound of the H, S and V channels.
+ * @throw runtime_error if the bounds are not set.
+ */
+void Table::getColorBounds(Vec3b &lower, Vec3b &upper) const {
+	if (!hasColorBounds_)
+		throw std::runtime_error("color bounds are not set");
+
+	lower = colorLower_;
+	upper = colorUpper_;
+}
+
 /**
  * @brief Return the transformation matrix for the Table.
  * @return the transformation matrix.
@@ -68,6 +90,17 @@ void Table::setColorRange(Vec2b colorRange) { // NOLINT(*-unnecessary-value-para
 	colorRange_ = colorRange;
 }
 
+/**
+ * @brief Set the HSV bounds of the color of the Table, they replace the hue range in the masks of the table color.
+ * @param lower lower bound of the H, S and V channels.
+ * @param upper upper bound of the H, S and V channels.
+ */
+void Table::setColorBounds(const Vec3b &lower, const Vec3b &upper) {
+	colorLower_ = lower;
+	colorUpper_ = upper;
+	hasColorBounds_ = true;
+}
+
 /**
  * @brief Set the transform matrix of the Table.
  * @param transform transform matrix of the Table.
@@ -0,0 +1,160 @@
+// Author: Michele Sprocatti
+
+#include "tableColorModel.h"
+
+#include <stdexcept>
+#include <opencv2/opencv.hpp>
+#include "constants.h"
+
+using namespace cv;
+using namespace std;
+
+// const used by the model
+const int WORKING_WIDTH = 320;	// width of the frames used to estimate the color
+const int MIN_SAMPLES = 200;	// minimum number of table pixels to update the model
+const double LEARNING_RATE = 0.1;	// weight of the new frame in the running mean and variance
+const double BOUND_SIGMAS = 2.5;	// half width of the color bounds in standard deviations
+const double GATE_SIGMAS = 3.5;	// half width of the bounds of the confirmed pixels in standard deviations
+const double MIN_HUE_HALF_WIDTH = 5;	// minimum half width of the hue bounds
+const double MAX_HUE_HALF_WIDTH = 15;	// maximum half width of the hue bounds
+const double BALL_MARGIN = 1.25;	// scale of the region excluded around each ball
+
+/**
+ * @brief Compute the HSV bounds of a Gaussian color.
+ * The hue is bounded on both sides, the saturation and the value only from below because the highlights of the
+ * cloth are still table.
+ * @param mean mean of the H, S and V channels.
+ * @param stdDev standard deviation of the H, S and V channels.
+ * @param sigmas half width of the bounds in standard deviations.
+ * @param lower output lower bound.
+ * @param upper output upper bound.
+ */
+void gaussianBounds(const Vec3d &mean, const Vec3d &stdDev, double sigmas, Vec3b &lower, Vec3b &upper) {
+	double hueHalfWidth = min(max(sigmas * stdDev[0], MIN_HUE_HALF_WIDTH), MAX_HUE_HALF_WIDTH);
+	lower = Vec3b(saturate_cast<uchar>(max(mean[0] - hueHalfWidth, 0.0)),
+				  saturate_cast<uchar>(mean[1] - sigmas * stdDev[1]),
+				  saturate_cast<uchar>(mean[2] - sigmas * stdDev[2]));
+	upper = Vec3b(saturate_cast<uchar>(min(mean[0] + hueHalfWidth, 179.0)), 255, 255);
+}
+
+/**
+ * @brief Constructor.
+ * The frames are analyzed at a reduced resolution and only inside the table polygon.
+ * @param corners corners of the table in the frame.
+ * @param frameSize size of the frames that will be analyzed.
+ * @throw invalid_argument if the frame size is empty.
+ */
+TableColorModel::TableColorModel(const Vec<Point2f, 4> &corners, const Size &frameSize) {
+	reset(corners, frameSize);
+}
+
+/**
+ * @brief Start modeling the table of a new clip, the buffers of the previous one are reused.
+ * The polygon of the table is drawn again and the model is cleared, so the next update estimates it from scratch.
+ * @param corners corners of the table in the frame.
+ * @param frameSize size of the frames that will be analyzed.
+ * @throw invalid_argument if the frame size is empty.
+ */
+void TableColorModel::reset(const Vec<Point2f, 4> &corners, const Size &frameSize) {
+	if(frameSize.empty())
+		throw invalid_argument("Empty frame size");
+
+	frameSize_ = frameSize;
+	scale_ = min(1.0, static_cast<double>(WORKING_WIDTH) / frameSize.width);
+	Size workingSize = Size(cvRound(frameSize.width * scale_), cvRound(frameSize.height * scale_));
+
+	vector<Point> cornersInt;
+	for(int i = 0; i < 4; i++)
+		cornersInt.push_back(Point(cvRound(corners[i].x * scale_), cvRound(corners[i].y * scale_)));
+	polygon_.create(workingSize, CV_8UC1);
+	polygon_.setTo(0);
+	fillConvexPoly(polygon_, cornersInt, 255);
+
+	mean_ = Vec3d(0, 0, 0);
+	variance_ = Vec3d(0, 0, 0);
+	initialized_ = false;
+}
+
+/**
+ * @brief Update the model with a new frame and set the color bounds of the table.
+ * The confirmed table pixels are the pixels inside the polygon, outside the balls and inside the bounds of the
+ * model widened to GATE_SIGMAS (the color range of the table before the first update). Their mean and variance
+ * update the running ones with an exponential moving average, then the bounds of the table are set to BOUND_SIGMAS
+ * standard deviations around the mean. The gate is wider than the bounds so that the model can follow a drift.
+ * @param frame new frame, BGR format requested.
+ * @param table table whose color bounds are updated.
+ * @param balls balls in the frame, their pixels are excluded.
+ * @return true if the bounds of the table have been updated, false if there were not enough table pixels.
+ * @throw invalid_argument if frame is empty or if its size is different from the one given to the constructor.
+ */
+bool TableColorModel::update(const Mat &frame, Table &table, const vector<Ball> &balls) {
+	if(frame.empty())
+		throw invalid_argument("Empty image in input");
+
+	if(frame.size() != frameSize_)
+		throw invalid_argument("Frame size different from the expected one");
+
+	Mat small, hsv, mask;
+	resize(frame, small, polygon_.size(), 0, 0, INTER_AREA);
+	cvtColor(small, hsv, COLOR_BGR2HSV);
+
+	// confirmed table pixels
+	Vec3b lower, upper;
+	if(initialized_) {
+		gaussianBounds(mean_, getStdDev(), GATE_SIGMAS, lower, upper);
+	} else {
+		Vec2b colorRange = table.getColorRange();
+		lower = Vec3b(colorRange[0], S_CHANNEL_COLOR_THRESHOLD, V_CHANNEL_COLOR_THRESHOLD);
+		upper = Vec3b(colorRange[1], 255, 255);
+	}
+	inRange(hsv, Scalar(lower[0], lower[1], lower[2]), Scalar(upper[0], upper[1], upper[2]), mask);
+	bitwise_and(mask, polygon_, mask);
+	for(const Ball &ball : balls) {
+		if(!ball.getVisibility())
+			continue;
+		Rect bbox = ball.getBbox();
+		Point2f center = (Point2f(bbox.tl()) + Point2f(bbox.br())) * 0.5f * scale_;
+		int radius = cvCeil(max(bbox.width, bbox.height) * 0.5 * BALL_MARGIN * scale_);
+		circle(mask, center, radius, 0, FILLED);
+	}
+
+	if(countNonZero(mask) < MIN_SAMPLES)
+		return false;
+
+	Scalar mean, stdDev;
+	meanStdDev(hsv, mean, stdDev, mask);
+	for(int c = 0; c < 3; c++) {
+		double variance = stdDev[c] * stdDev[c];
+		if(initialized_) {
+			// running variance around the new mean
+			double delta = mean[c] - mean_[c];
+			mean_[c] += LEARNING_RATE * delta;
+			variance_[c] = (1 - LEARNING_RATE) * (variance_[c] + LEARNING_RATE * delta * delta)
+						   + LEARNING_RATE * variance;
+		} else {
+			mean_[c] = mean[c];
+			variance_[c] = variance;
+		}
+	}
+	initialized_ = true;
+
+	gaussianBounds(mean_, getStdDev(), BOUND_SIGMAS, lower, upper);
+	table.setColorBounds(lower, upper);
+	return true;
+}
+
+/**
+ * @brief Return the mean color of the table.
+ * @return the running mean of the H, S and V channels.
+ */
+Vec3d TableColorModel::getMean() const {
+	return mean_;
+}
+
+/**
+ * @brief Return the standard deviation of the color of the table.
+ * @return the running standard deviation of the H, S and V channels.
+ */
+Vec3d TableColorModel::getStdDev() const {
+	return Vec3d(sqrt(variance_[0]), sqrt(variance_[1]), sqrt(variance_[2]));
+}
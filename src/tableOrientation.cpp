@@ -128,8 +128,11 @@ bool checkHorizontalTable(const Mat &tableImg, Vec<Point2f, 4> corners){
 	// mask the image
 	Mat maskImg;
 	Mat frameHSV;
-	Vec2b backgroundColor = mostFrequentHueColor(tableImg);
+	Mat hist;
+	// the image is converted only once, the histogram is computed on the converted image
 	cvtColor(tableImg, frameHSV, COLOR_BGR2HSV);
+	computeHueHistogram(frameHSV, hist);
+	Vec2b backgroundColor = mostFrequentHueInHistogram(hist);
 	inRange(frameHSV, Scalar(backgroundColor[0], 50, 90),
 				Scalar(backgroundColor[1], 255, 255), maskImg);
 	//imshow("Mask img", maskImg);
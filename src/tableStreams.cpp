@@ -0,0 +1,157 @@
+// Author: Michele Sprocatti
+
+#include "tableStreams.h"
+
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include "videoIO.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ * @brief Constructor, it opens the videos and analyzes the first frame.
+ * @param videoPath path of the input video.
+ * @param outputPath path of the output video with the minimap.
+ * @param config configuration of the analysis.
+ * @throw invalid_argument if the input video cannot be read or the output video cannot be written.
+ */
+TableStream::TableStream(const string &videoPath, const string &outputPath, const PoolAnalyzerConfig &config)
+		: frames_(config.maxTrackingStep + 1), analyzer_(config) {
+	videoPath_ = videoPath;
+	frameCount_ = 0;
+	finished_ = false;
+
+	VideoIOConfig ioConfig;
+	if (!openCapture(video_, videoPath, ioConfig) || !frames_.read(video_))
+		throw invalid_argument("Error opening video file " + videoPath);
+	const Mat &firstFrame = frames_.get();
+	double fps = video_.get(CAP_PROP_FPS);
+	if (!openWriter(writer_, outputPath, fps, firstFrame.size(), ioConfig))
+		throw invalid_argument("Error opening output video file " + outputPath);
+
+	writer_.write(analyzer_.init(firstFrame, fps).output);
+	frameCount_ = 1;
+	pending_.reserve(config.maxTrackingStep);
+}
+
+/**
+ * @brief Analyze the frames of the next tracking step and write them in the output video.
+ * The frames of the step are decoded in the ring buffer, the balls are tracked in the last one and interpolated in
+ * the others. At the end of the video the balls are detected in the last frame and the output video is closed.
+ * @return true if there are other frames to analyze, false if the stream is finished.
+ */
+bool TableStream::step() {
+	if (finished_)
+		return false;
+
+	int step = analyzer_.getStep();
+	pending_.clear();
+	while (pending_.size() < step && frames_.read(video_))
+		pending_.emplace_back();
+
+	// the pending frames are headers on the ring buffer, from the oldest to the most recent
+	const int n = pending_.size();
+	if (n > 0) {
+		for (int j = 0; j < n; j++)
+			pending_[j] = frames_.get(n - 1 - j);
+		for (const FrameResult &result : analyzer_.process(pending_))
+			writer_.write(result.output);
+		frameCount_ += n;
+	}
+
+	if (n < step) {
+		analyzer_.finish(frames_.get());
+		writer_.release();
+		video_.release();
+		finished_ = true;
+	}
+	return !finished_;
+}
+
+/**
+ * @brief Return the number of analyzed frames.
+ * @return the number of frames.
+ */
+int TableStream::getFrameCount() const {
+	return frameCount_;
+}
+
+/**
+ * @brief Return true if the video has been completely analyzed.
+ * @return true if the stream is finished.
+ */
+bool TableStream::isFinished() const {
+	return finished_;
+}
+
+/**
+ * @brief Return the path of the input video.
+ * @return the path.
+ */
+const string &TableStream::getVideoPath() const {
+	return videoPath_;
+}
+
+/**
+ * @brief Return the analyzer of the table.
+ * @return the analyzer.
+ */
+PoolAnalyzer &TableStream::getAnalyzer() {
+	return analyzer_;
+}
+
+/**
+ * @brief Analyze many table streams concurrently on the OpenCV thread pool.
+ * Each worker repeatedly takes the idle stream with the fewest analyzed frames and advances it by one tracking step,
+ * so the streams progress at the same pace in frames and no stream is starved by the others. A stream is advanced
+ * by one worker at a time; the OpenCV functions called inside a step run serially, so the pool is not
+ * oversubscribed.
+ * @param streams streams to analyze.
+ * @param errors output error of each stream, empty if the stream has been analyzed correctly.
+ */
+void analyzeStreams(vector<Ptr<TableStream>> &streams, vector<string> &errors) {
+	errors.assign(streams.size(), string());
+	if (streams.empty())
+		return;
+	vector<bool> busy(streams.size(), false);
+	vector<bool> done(streams.size(), false);
+	for (int i = 0; i < streams.size(); i++)
+		done[i] = streams[i]->isFinished();
+	mutex scheduleMutex;
+
+	const int workers = std::min(static_cast<int>(streams.size()), std::max(getNumThreads(), 1));
+	parallel_for_(Range(0, workers), [&](const Range &range) {
+		for (int w = range.start; w < range.end; w++) {
+			while (true) {
+				int chosen = -1;
+				{
+					lock_guard<mutex> lock(scheduleMutex);
+					for (int i = 0; i < streams.size(); i++)
+						if (!busy[i] && !done[i]
+							&& (chosen < 0 || streams[i]->getFrameCount() < streams[chosen]->getFrameCount()))
+							chosen = i;
+					if (chosen < 0)
+						break;
+					busy[chosen] = true;
+				}
+
+				bool more;
+				string error;
+				try {
+					more = streams[chosen]->step();
+				} catch (const exception &e) {
+					error = e.what();
+					more = false;
+				}
+
+				lock_guard<mutex> lock(scheduleMutex);
+				busy[chosen] = false;
+				done[chosen] = !more;
+				errors[chosen] = error;
+			}
+		}
+	}, workers);
+}
@@ -1,6 +1,5 @@
 // Author: Michele Sprocatti
 
-#include <opencv2/videoio.hpp>
 #include <iostream>
 #include <filesystem>
 
@@ -10,6 +9,7 @@
 #include "segmentation.h"
 #include "metrics.h"
 #include "util.h"
+#include "frameAccess.h"
 
 using namespace std;
 using namespace cv;
@@ -26,7 +26,6 @@ int main(int argc, char *argv[]){
 	Mat segmented;
 	Mat previousFrame;
 	Mat detected;
-	bool ret;
 
 	vector<double> metricsAP;
 	vector<double> metricsIoU;
@@ -37,8 +36,8 @@ int main(int argc, char *argv[]){
 							"/game4_clip2"};
 
 	for (int i = 0; i < name.size(); i++){
-		VideoCapture vid = VideoCapture("../Dataset"+name[i]+name[i]+".mp4");
-		vid.read(frame);
+		// only the first and the last frame are needed, they are decoded once and cached
+		frame = FrameStore::instance().get("../Dataset"+name[i], FIRST);
 		detectTable(frame, tableCorners, colorTable);
 		table = Table(tableCorners, colorTable);
 		cout << "--------------" << endl;
@@ -60,13 +59,7 @@ int main(int argc, char *argv[]){
 		for(int c = 0; c < metricsIoU.size(); c++)
 			cout << "IoU for category " << c << ": " << metricsIoU[c] << endl;
 		waitKey(0);
-		previousFrame = frame.clone();
-		ret = vid.read(frame);
-		while (vid.isOpened() && ret){
-
-			previousFrame = frame.clone();
-			ret = vid.read(frame);
-		}
+		previousFrame = FrameStore::instance().get("../Dataset"+name[i], LAST);
 		cout << "------ Last frame --------" << endl;
 		table.clearBalls();
 		detectBalls(previousFrame, table);
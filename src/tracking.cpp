@@ -3,17 +3,77 @@
 #include "tracking.h"
 #include "ball.h"
 #include <opencv2/tracking.hpp>
+#include <opencv2/imgproc.hpp>
 #include <iostream>
+#include <algorithm>
+#include <stdexcept>
 #include "metrics.h"
 #include "util.h"
+#include "profiler.h"
 
 using namespace cv;
 
+// const used by the refinement of the centers
+const int CLOTH_BORDER = 3;	// width of the border of the bbox used to estimate the color of the cloth
+const int BALL_COLOR_DISTANCE = 60;	// minimum sum of the channel differences from the cloth of a ball pixel
+const double MIN_BALL_FRACTION = 0.2;	// minimum fraction of ball pixels in the disk inscribed in the bbox
+const double MAX_CENTER_SHIFT = 0.25;	// maximum shift from the bbox center, in fraction of the bbox size
+
+/**
+ * @brief Compute the center of a ball with sub-pixel precision inside its bounding box.
+ * The color of the cloth is the mean color of the border of the bbox, that is larger than the ball; the pixels of
+ * the disk inscribed in the bbox that differ from it form the mask of the ball and the center is the centroid of
+ * the mask. The fallback is returned if the mask is too small or its centroid is too far from the bbox center,
+ * for example when the ball is near the cushion or another ball.
+ * @param frame input frame, BGR format requested.
+ * @param bbox bounding box containing the ball and a border of cloth around it.
+ * @param fallback center returned when the ball cannot be separated from the cloth.
+ * @return the refined center of the ball.
+ */
+Point2f refineBallCenter(const Mat &frame, const Rect &bbox, const Point2f &fallback) {
+	Rect region = bbox & Rect(0, 0, frame.cols, frame.rows);
+	if (region != bbox || bbox.width <= 2 * CLOTH_BORDER || bbox.height <= 2 * CLOTH_BORDER)
+		return fallback;
+	Mat roi = frame(region);
+
+	Mat border = Mat(roi.size(), CV_8UC1, Scalar(255));
+	border(Rect(CLOTH_BORDER, CLOTH_BORDER, roi.cols - 2 * CLOTH_BORDER, roi.rows - 2 * CLOTH_BORDER)) = 0;
+	Scalar cloth = mean(roi, border);
+
+	Mat difference, distance, mask;
+	absdiff(roi, cloth, difference);
+	transform(difference, distance, Matx13f(1, 1, 1));
+	threshold(distance, mask, BALL_COLOR_DISTANCE, 255, THRESH_BINARY);
+	Mat disk = Mat::zeros(roi.size(), CV_8UC1);
+	Point2f bboxCenter = Point2f(roi.cols / 2.0f, roi.rows / 2.0f);
+	float radius = std::min(roi.cols, roi.rows) / 2.0f;
+	circle(disk, bboxCenter, cvRound(radius), 255, FILLED);
+	bitwise_and(mask, disk, mask);
+
+	Moments m = moments(mask, true);
+	if (m.m00 < MIN_BALL_FRACTION * CV_PI * radius * radius)
+		return fallback;
+	Point2f centroid = Point2f(m.m10 / m.m00, m.m01 / m.m00);
+	if (norm(centroid - bboxCenter) > MAX_CENTER_SHIFT * 2 * radius)
+		return fallback;
+	return centroid + Point2f(region.tl());
+}
+
 /**
  * @brief Constructor.
  * @param balls pointer to the vector of balls to track.
  */
 BilliardTracker::BilliardTracker(Ptr<std::vector<Ball>> balls) { // NOLINT(*-unnecessary-value-param)
+	reset(balls);
+}
+
+
+/**
+ * @brief Start tracking the balls of a new clip, the trackers of the previous one are reused.
+ * The trackers are initialized again on the first tracked frame, which discards their previous model.
+ * @param balls pointer to the vector of balls to track.
+ */
+void BilliardTracker::reset(Ptr<std::vector<Ball>> balls) { // NOLINT(*-unnecessary-value-param)
 	isInitialized_ = false;
 
 	ballsVec_ = balls;
@@ -24,10 +84,12 @@ BilliardTracker::BilliardTracker(Ptr<std::vector<Ball>> balls) { // NOLINT(*-unn
 
 /**
  * @brief Create the trackers for all the balls in the vector.
- * Used the first time tracker is called.
+ * Used the first time tracker is called. The trackers of a previous clip are kept, only the missing ones are created.
 */
 void BilliardTracker::createTrackers() {
-	for (unsigned short i = 0; i < ballsVec_->size(); i++) {
+	if (ballTrackers_.size() > ballsVec_->size())
+		ballTrackers_.resize(ballsVec_->size());
+	for (unsigned short i = ballTrackers_.size(); i < ballsVec_->size(); i++) {
 		Ptr<Tracker> tracker = TrackerCSRT::create();    //parameters go here if necessary
 		ballTrackers_.push_back(tracker);
 	}
@@ -39,7 +101,8 @@ void BilliardTracker::createTrackers() {
 /**
  * @brief Track the ball with the given index in the input frame.
  * It performs OpenCV Tracker initialization the first time it is called.
- * The returned bounding box is not updated if the IoU with the previous one is too high.
+ * The returned bounding box is not updated if the IoU with the previous one is too high. The center of a visible
+ * ball is refined in every frame inside the retained bounding box, also when the box is not updated.
  * @param ballIndex index of the ball to track.
  * @param frame input frame.
  * @param callInit flag that indicates if the tracker has to be initialized.
@@ -47,12 +110,15 @@ void BilliardTracker::createTrackers() {
  */
 Rect BilliardTracker::trackOne(unsigned short ballIndex, const Mat &frame, bool callInit /*= false*/) {
 	Rect bbox = ballsVec_->at(ballIndex).getBbox();
+	Point2f center = ballsVec_->at(ballIndex).getCenter();
 	ballsVec_->at(ballIndex).setBbox_prec(bbox);
+	ballsVec_->at(ballIndex).setCenter_prec(center);
 
 	bool isBboxUpdated = false;
 	if (callInit) {
 		enlargeRect(bbox, 10);  // enlarge bbox to enhance tracking performance
 		ballTrackers_[ballIndex]->init(frame, bbox);
+		ballsVec_->at(ballIndex).setCenter(refineBallCenter(frame, bbox, center));
 	} else {
 		if(ballsVec_->at(ballIndex).getVisibility())	// track only visible balls
 		{
@@ -63,6 +129,8 @@ Rect BilliardTracker::trackOne(unsigned short ballIndex, const Mat &frame, bool
 			} else {
 				ballsVec_->at(ballIndex).setBbox(bbox); // do not update if shift is too little (use IoU)
 			}
+			Ball &ball = ballsVec_->at(ballIndex);
+			ball.setCenter(refineBallCenter(frame, ball.getBbox(), ball.getCenter()));
 		}
 	}
 
@@ -78,7 +146,8 @@ Rect BilliardTracker::trackOne(unsigned short ballIndex, const Mat &frame, bool
  * @return a pointer to the vector of the tracked balls. It is the same as the one provided to the constructor.
  */
 Ptr<std::vector<Ball>> BilliardTracker::trackAll(const Mat &frame) {
-	
+	ScopedTimer timer("trackAll");
+
 	if (!isInitialized_) {
 		createTrackers();
 		for (unsigned short i = 0; i < ballsVec_->size(); i++) {
@@ -93,3 +162,108 @@ Ptr<std::vector<Ball>> BilliardTracker::trackAll(const Mat &frame) {
 
 	return ballsVec_;
 }
+
+
+/**
+ * @brief Constructor.
+ * @param balls pointer to the vector of balls to track.
+ * @param maxStep maximum number of frames between two tracked frames, 1 to track all the frames.
+ * @throw invalid_argument if maxStep is less than 1.
+ */
+FrameSkippingTracker::FrameSkippingTracker(Ptr<std::vector<Ball>> balls, int maxStep) : tracker_(balls) { // NOLINT(*-unnecessary-value-param)
+	reset(balls, maxStep);
+}
+
+
+/**
+ * @brief Start tracking the balls of a new clip, the trackers of the previous one are reused.
+ * @param balls pointer to the vector of balls to track.
+ * @param maxStep maximum number of frames between two tracked frames, 1 to track all the frames.
+ * @throw invalid_argument if maxStep is less than 1.
+ */
+void FrameSkippingTracker::reset(Ptr<std::vector<Ball>> balls, int maxStep) { // NOLINT(*-unnecessary-value-param)
+	if (maxStep < 1)
+		throw std::invalid_argument("The maximum step must be at least 1");
+
+	tracker_.reset(balls);
+	ballsVec_ = balls;
+	maxStep_ = maxStep;
+	step_ = 1;
+}
+
+
+/**
+ * @brief Return the number of frames to decode before the next tracked frame.
+ * @return the current step.
+ */
+int FrameSkippingTracker::getStep() const {
+	return step_;
+}
+
+
+/**
+ * @brief Track the balls in a frame and interpolate their positions in the skipped frames before it.
+ * The bounding boxes and the centers in the skipped frames are linearly interpolated between the previous tracked
+ * frame and this one. Then the step is adapted: the fastest ball must not move more than a few pixels between two tracked frames,
+ * otherwise the tracker could lose it.
+ * @param frame frame to track.
+ * @param frames number of frames from the previous tracked frame to this one, this one included.
+ * @param interpolated output balls in each skipped frame, in order; it contains frames - 1 elements.
+ * @throw invalid_argument if frames is less than 1.
+ */
+void FrameSkippingTracker::track(const Mat &frame, int frames, std::vector<std::vector<Ball>> &interpolated) {
+	// maximum shift of a ball between two tracked frames, in pixels
+	const float MAX_SHIFT_PER_STEP = 8;
+
+	if (frames < 1)
+		throw std::invalid_argument("The number of frames must be at least 1");
+
+	std::vector<Rect> previousBboxes;
+	std::vector<Point2f> previousCenters;
+	previousBboxes.reserve(ballsVec_->size());
+	previousCenters.reserve(ballsVec_->size());
+	for (const Ball &ball : *ballsVec_) {
+		previousBboxes.push_back(ball.getBbox());
+		previousCenters.push_back(ball.getCenter());
+	}
+
+	tracker_.trackAll(frame);
+
+	// interpolation in the skipped frames, the previous box of each frame is the box of the frame before it
+	interpolated.resize(frames - 1);
+	for (int j = 1; j < frames; j++) {
+		float t = static_cast<float>(j) / frames;
+		interpolated[j - 1] = *ballsVec_;
+		for (unsigned short i = 0; i < ballsVec_->size(); i++) {
+			Rect from = previousBboxes[i];
+			Rect to = ballsVec_->at(i).getBbox();
+			Rect bbox = Rect(cvRound(from.x + t * (to.x - from.x)), cvRound(from.y + t * (to.y - from.y)),
+							 cvRound(from.width + t * (to.width - from.width)),
+							 cvRound(from.height + t * (to.height - from.height)));
+			interpolated[j - 1][i].setBbox(bbox);
+			interpolated[j - 1][i].setBbox_prec(j == 1 ? from : interpolated[j - 2][i].getBbox());
+			interpolated[j - 1][i].setCenter(previousCenters[i] + t * (ballsVec_->at(i).getCenter() - previousCenters[i]));
+			interpolated[j - 1][i].setCenter_prec(j == 1 ? previousCenters[i] : interpolated[j - 2][i].getCenter());
+		}
+	}
+	if (frames > 1)
+		for (unsigned short i = 0; i < ballsVec_->size(); i++) {
+			ballsVec_->at(i).setBbox_prec(interpolated[frames - 2][i].getBbox());
+			ballsVec_->at(i).setCenter_prec(interpolated[frames - 2][i].getCenter());
+		}
+
+	// adapt the step to the speed of the fastest visible ball
+	float maxSpeed = 0;
+	for (unsigned short i = 0; i < ballsVec_->size(); i++) {
+		if (ballsVec_->at(i).getVisibility()) {
+			Rect previous = previousBboxes[i];
+			Point2f previousCenter = Point2f(previous.x + previous.width / 2, previous.y + previous.height / 2);
+			Point2f shift = ballsVec_->at(i).getBBoxCenter() - previousCenter;
+			maxSpeed = std::max(maxSpeed, static_cast<float>(norm(shift)) / frames);
+		}
+	}
+	if (maxSpeed > 0)
+		step_ = std::min(std::max(static_cast<int>(MAX_SHIFT_PER_STEP / maxSpeed), 1), maxStep_);
+	else
+		step_ = maxStep_;
+}
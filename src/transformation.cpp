@@ -4,6 +4,8 @@
 #include "constants.h"
 #include "tableOrientation.h"
 #include "util.h"
+#include "profiler.h"
+#include "minimap.h"
 
 using namespace cv;
 using namespace std;
@@ -79,21 +81,58 @@ Mat computeTransformation(const Mat& img, Vec<Point2f, 4>  &imgCorners) {
 }
 
 /**
- * @brief Draw the balls and their tracking on the minimap.
- * First compute the current and previous positions of the balls using the transformation matrix.
- * Draw the tracking lines in the image that will be reused in the next frames. Use a copy of the
- * previous image to draw the balls with their correct colors.
- * @param minimapWithTrack minimap image in which the tracking lines are kept.
+ * @brief Classify the positions in the minimap with respect to the playing field and the pockets.
+ * The playing field in the minimap is an axis-aligned rectangle, so all the positions are checked in a single pass
+ * with four comparisons each, and only the positions outside of it are compared with the pockets. A position outside
+ * the table boundaries is in a pocket if its distance from the center of the pocket is less than the radius of the
+ * pocket plus the radius of a ball.
+ * @param mapPositions positions in the minimap coordinates.
+ * @param regions output vector containing the region of each position.
+ */
+void classifyMinimapPositions(const vector<Point2f> &mapPositions, vector<MapRegion> &regions) {
+	const float MIN_X = TOP_LEFT_MAP_CORNER.x;
+	const float MAX_X = BOTTOM_RIGHT_MAP_CORNER.x;
+	const float MIN_Y = TOP_LEFT_MAP_CORNER.y;
+	const float MAX_Y = BOTTOM_RIGHT_MAP_CORNER.y;
+	const float POCKET_DISTANCE = MAP_POCKET_RADIUS + MAP_BALL_RADIUS;
+	const float POCKET_DISTANCE_SQUARED = POCKET_DISTANCE * POCKET_DISTANCE;
+
+	regions.resize(mapPositions.size());
+
+	//playing field test, without branches
+	for(size_t i = 0; i < mapPositions.size(); i++) {
+		const Point2f &p = mapPositions[i];
+		bool inside = (p.x >= MIN_X) & (p.x <= MAX_X) & (p.y >= MIN_Y) & (p.y <= MAX_Y);
+		regions[i] = inside ? PLAYING_FIELD_REGION : OUTSIDE_REGION;
+	}
+
+	//pocket test only for the positions outside the playing field
+	for(size_t i = 0; i < mapPositions.size(); i++) {
+		if(regions[i] == PLAYING_FIELD_REGION)
+			continue;
+		for(int k = 0; k < NUMBER_POCKETS; k++) {
+			Point2f d = mapPositions[i] - MAP_POCKETS[k];
+			if(d.x * d.x + d.y * d.y <= POCKET_DISTANCE_SQUARED) {
+				regions[i] = POCKET_REGION;
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Compute the positions of the balls in the minimap and update their visibility.
+ * The current and previous centers of the balls, with sub-pixel precision, are transformed and classified together. A ball whose current position is in
+ * a pocket is set as not visible, so it is no more tracked nor drawn. A ball outside the playing field but far from
+ * the pockets is kept visible: it is not drawn in this frame, but it is drawn again if it comes back.
  * @param transform transformation matrix.
  * @param balls vector of balls containing their positions in the original image.
- * @return minimap image with tracking lines and balls.
- * @throw invalid_argument if the image in input is empty
+ * @param positions output positions of the balls in the minimap.
  * @throw invalid_argument if the transformation matrix in input is empty
  * @throw invalid_argument if the balls pointer is a null pointer
  */
-Mat drawMinimap(Mat &minimapWithTrack, const Mat &transform, Ptr<vector<Ball>> balls) {
-	if(minimapWithTrack.empty())
-		throw invalid_argument("Empty image in input");
+void computeMinimapPositions(const Mat &transform, Ptr<vector<Ball>> balls, MinimapPositions &positions) {
+	ScopedTimer timer("computeMinimapPositions");
 
 	if(transform.empty())
 		throw invalid_argument("Empty transformation matrix in input");
@@ -101,50 +140,127 @@ Mat drawMinimap(Mat &minimapWithTrack, const Mat &transform, Ptr<vector<Ball>> b
 	if(balls == nullptr)
 		throw invalid_argument("Null pointer");
 
-	if(balls->empty())
-		return minimapWithTrack;
+	const size_t n = balls->size();
+	positions.current.resize(n);
+	positions.previous.resize(n);
+	positions.currentRegion.resize(n);
+	positions.previousRegion.resize(n);
+	positions.hasPrevious.resize(n);
+	if(n == 0)
+		return;
 
-	//compute balls and prec balls positions in the image
-	vector<Point2f> imgBallsPos (balls->size());
-	vector<Point2f> imgPrecBallsPos (balls->size());
-	vector<Vec3b> ballColors (balls->size());
-	for(int i = 0; i < balls->size(); i++) {
-		imgBallsPos[i] = (balls->at(i)).getBBoxCenter();
-		ballColors[i] = getColorFromCategory((balls->at(i)).getCategory());
-		imgPrecBallsPos[i] = (balls->at(i)).getBboxCenter_prec();
+	//current positions followed by the previous ones, to transform and classify them in one pass
+	vector<Point2f> imgPos (2 * n);
+	for(size_t i = 0; i < n; i++) {
+		imgPos[i] = (balls->at(i)).getCenter();
+		imgPos[n + i] = (balls->at(i)).getCenter_prec();
+		positions.hasPrevious[i] = imgPos[n + i].x != -1 && imgPos[n + i].y != -1;
 	}
 
-	//compute balls and prec balls positions in the map
-	vector<Point2f> mapBallsPos;
-	perspectiveTransform(imgBallsPos, mapBallsPos, transform);
-	vector<Point2f> mapPrecBallsPos;
-	perspectiveTransform(imgPrecBallsPos, mapPrecBallsPos, transform);
+	vector<Point2f> mapPos;
+	perspectiveTransform(imgPos, mapPos, transform);
+	vector<MapRegion> regions;
+	classifyMinimapPositions(mapPos, regions);
+
+	for(size_t i = 0; i < n; i++) {
+		positions.current[i] = mapPos[i];
+		positions.previous[i] = mapPos[n + i];
+		positions.currentRegion[i] = regions[i];
+		positions.previousRegion[i] = regions[n + i];
+
+		//a scored ball is no more visible
+		if(regions[i] == POCKET_REGION)
+			(balls->at(i)).setVisibility(false);
+	}
+}
+
+/**
+ * @brief Draw the balls and their tracking on the minimap using the positions already computed.
+ * Draw the tracking lines in the image that will be reused in the next frames. Use a copy of the
+ * previous image to draw the balls with their correct colors. Only visible balls inside the playing field are drawn.
+ * @param minimapWithTrack minimap image in which the tracking lines are kept.
+ * @param positions positions of the balls in the minimap.
+ * @param balls vector of balls used to compute the positions.
+ * @return minimap image with tracking lines and balls.
+ * @throw invalid_argument if the image in input is empty
+ * @throw invalid_argument if the balls pointer is a null pointer
+ */
+Mat drawMinimap(Mat &minimapWithTrack, const MinimapPositions &positions, Ptr<vector<Ball>> balls) {
+	Mat minimapWithBalls;
+	drawMinimap(minimapWithTrack, positions, balls, minimapWithBalls);
+	return minimapWithBalls;
+}
+
+/**
+ * @brief Draw the balls and their tracking on the minimap using the positions already computed, in a given image.
+ * Draw the tracking lines in the image that will be reused in the next frames. Copy it in the output image, without
+ * allocations if it has the same size, and draw the balls with their correct colors there.
+ * Only visible balls inside the playing field are drawn.
+ * @param minimapWithTrack minimap image in which the tracking lines are kept.
+ * @param positions positions of the balls in the minimap.
+ * @param balls vector of balls used to compute the positions.
+ * @param minimapWithBalls output minimap image with tracking lines and balls, its buffer is reused if it has the same size.
+ * @throw invalid_argument if the image in input is empty
+ * @throw invalid_argument if the balls pointer is a null pointer
+ */
+void drawMinimap(Mat &minimapWithTrack, const MinimapPositions &positions, Ptr<vector<Ball>> balls, Mat &minimapWithBalls) {
+	ScopedTimer timer("drawMinimap");
+
+	if(minimapWithTrack.empty())
+		throw invalid_argument("Empty image in input");
+
+	if(balls == nullptr)
+		throw invalid_argument("Null pointer");
 
 	//draw tracking lines
 	for(int i = 0; i < balls->size(); i++) {
 		//check if a previous ball exists, otherwise do not draw a line
-		if(imgPrecBallsPos[i].x != -1 && imgPrecBallsPos[i].y != -1 && (balls->at(i)).getVisibility()) {
-			if(pointPolygonTest	(MAP_CORNERS, mapBallsPos[i], false) >= 0
-				&& pointPolygonTest	(MAP_CORNERS, mapPrecBallsPos[i], false) >= 0) {
-				line(minimapWithTrack, mapPrecBallsPos[i], mapBallsPos[i], Vec3d(0, 0, 0), 2);
-			}
-			else {
-				(balls->at(i)).setVisibility(false);
-			}
+		if(positions.hasPrevious[i] && (balls->at(i)).getVisibility()
+			&& positions.currentRegion[i] == PLAYING_FIELD_REGION
+			&& positions.previousRegion[i] == PLAYING_FIELD_REGION) {
+			line(minimapWithTrack, positions.previous[i], positions.current[i], Vec3d(0, 0, 0), 2);
 		}
 	}
 
-	//draw balls in the returned minimap
-	Mat minimapWithBalls = minimapWithTrack.clone();
+	//draw balls in the output minimap
+	minimapWithTrack.copyTo(minimapWithBalls);
 	for(int i = 0; i < balls->size(); i++) {
-		if((balls->at(i)).getVisibility()) {
-			if(pointPolygonTest	(MAP_CORNERS, mapBallsPos[i], false) >= 0) {
-				circle(minimapWithBalls, mapBallsPos[i], MAP_BALL_RADIUS, ballColors[i], -1);
-				circle(minimapWithBalls, mapBallsPos[i], MAP_BALL_RADIUS, Vec3d(0, 0, 0), 2);
-			}
-			else
-				(balls->at(i)).setVisibility(false);
+		if((balls->at(i)).getVisibility() && positions.currentRegion[i] == PLAYING_FIELD_REGION) {
+			Vec3b ballColor = getColorFromCategory((balls->at(i)).getCategory());
+			circle(minimapWithBalls, positions.current[i], MAP_BALL_RADIUS, ballColor, -1);
+			circle(minimapWithBalls, positions.current[i], MAP_BALL_RADIUS, Vec3d(0, 0, 0), 2);
 		}
 	}
-	return minimapWithBalls;
+}
+
+/**
+ * @brief Draw the balls and their tracking on the minimap.
+ * First compute the current and previous positions of the balls using the transformation matrix and classify them,
+ * then draw the tracking lines and the balls.
+ * @param minimapWithTrack minimap image in which the tracking lines are kept.
+ * @param transform transformation matrix.
+ * @param balls vector of balls containing their positions in the original image.
+ * @return minimap image with tracking lines and balls.
+ * @throw invalid_argument if the image in input is empty
+ * @throw invalid_argument if the transformation matrix in input is empty
+ * @throw invalid_argument if the balls pointer is a null pointer
+ */
+Mat drawMinimap(Mat &minimapWithTrack, const Mat &transform, Ptr<vector<Ball>> balls) {
+	if(minimapWithTrack.empty())
+		throw invalid_argument("Empty image in input");
+
+	MinimapPositions positions;
+	computeMinimapPositions(transform, balls, positions);
+	return drawMinimap(minimapWithTrack, positions, balls);
+}
+
+/**
+ * @brief Return the empty minimap image.
+ * The original is the png provided but we converted it to an header; it is decoded only the first time, the
+ * initialization of the static image is thread-safe so concurrent pipelines can call it.
+ * @return the minimap image in BGR format, shared by the whole program. It must not be modified.
+ */
+const Mat &emptyMinimap() {
+	static const Mat MINIMAP = imdecode(vector<unsigned char>(MINIMAP_DATA, MINIMAP_DATA + MINIMAP_DATA_SIZE), IMREAD_COLOR);
+	return MINIMAP;
 }
@@ -84,9 +84,14 @@ void computeIntersection(const Vec3f &line1, const Vec3f &line2, Point2f &inters
 	}
 }
 
+// bins and range of the Hue histogram
+const int HUE_HISTOGRAM_BINS = 8;
+const float HUE_HISTOGRAM_RANGE = 179+1;
+
 /**
  * @brief calculate the most frequent value of Hue in the input image.
  * Convert the image to HSv representation and then evaluate the histogram for the first channel.
+ * When the image is already available in HSV, computeHueHistogram and mostFrequentHueInHistogram avoid the conversion.
  * @param img input image in BGR format.
  * @return Vec2b the color interval corresponding to the most frequent Hue.
  * @throw invalid_argument if img is empty or if img has less than 3 channels.
@@ -99,21 +104,44 @@ Vec2b mostFrequentHueColor(const Mat &img){
 		throw invalid_argument("Invalid number of channels for the input image");
 
 	Mat thisImg, hist;
-	Mat argmax;
-
 	cvtColor(img, thisImg, COLOR_BGR2HSV);
-	const int numberOfBins = 8;
-	const float range[] = {0, 179+1};
+	computeHueHistogram(thisImg, hist);
+	return mostFrequentHueInHistogram(hist);
+}
+
+/**
+ * @brief calculate the histogram of the Hue channel of an image with 8 bins.
+ * @param hsvImg input image in HSV format.
+ * @param hist output histogram.
+ * @throw invalid_argument if hsvImg is empty or if hsvImg has a number of channels different from 3.
+ */
+void computeHueHistogram(const Mat &hsvImg, Mat &hist){
+
+	if(hsvImg.empty())
+		throw invalid_argument("Empty input image");
+	if(hsvImg.channels() != 3)
+		throw invalid_argument("Invalid number of channels for the input image");
+
+	const float range[] = {0, HUE_HISTOGRAM_RANGE};
 	const float* histRange[] = {range};
 
 	// Evaluate only H channel
 	const int c[] = {0};
-	calcHist(&thisImg, 1, c, Mat(), hist, 1, &numberOfBins, histRange);
+	calcHist(&hsvImg, 1, c, Mat(), hist, 1, &HUE_HISTOGRAM_BINS, histRange);
+}
+
+/**
+ * @brief calculate the most frequent Hue interval from a histogram computed by computeHueHistogram.
+ * @param hist histogram of the Hue channel.
+ * @return Vec2b the color interval corresponding to the most frequent Hue.
+ */
+Vec2b mostFrequentHueInHistogram(const Mat &hist){
+	Mat argmax;
 
 	// find the argmax
 	reduceArgMax(hist, argmax, 0);
-	int start = range[1] / numberOfBins * argmax.at<int>(0);
-	int diameter = range[1] / numberOfBins;
+	int start = HUE_HISTOGRAM_RANGE / HUE_HISTOGRAM_BINS * argmax.at<int>(0);
+	int diameter = HUE_HISTOGRAM_RANGE / HUE_HISTOGRAM_BINS;
 	return Vec2b(start, start + diameter);
 }
 
@@ -137,25 +165,57 @@ void createOutputImage(const Mat &frame, const Mat &minimapWithBalls, Mat &res){
 	int offset = static_cast<int>(percentage * frame.rows);
 
 	Mat resized;
-	res = frame.clone();
+	frame.copyTo(res);	// the buffer of res is reused if it has the same size
 	resize(minimapWithBalls, resized, Size(), scaling_factor, scaling_factor, INTER_LINEAR);
 	for(int i = 0; i < resized.rows; i++)
 		for(int j = 0; j < resized.cols; j++)
 			res.at<Vec3b>(i+offset,j) = resized.at<Vec3b>(i,j);
 }
 
+/**
+ * Implementation of a scope in which the random generator of OpenCV is replaced by a seeded generator.
+ * cv::kmeans draws the initial centers from theRNG(), which is thread-local: its state is saved when the scope
+ * starts and restored when it ends, also if an exception is thrown, so the caller never sees it modified.
+ */
+class SeededRNGScope {
+	RNG saved_;	// state of the thread-local generator before the scope.
+
+public:
+	/**
+	 * @brief Constructor, it replaces the thread-local generator with a generator with the given seed.
+	 * @param seed seed of the generator.
+	 */
+	explicit SeededRNGScope(uint64_t seed) : saved_(theRNG()) {
+		theRNG() = RNG(seed);
+	}
+
+	/**
+	 * @brief Destructor, it restores the thread-local generator.
+	 */
+	~SeededRNGScope() {
+		theRNG() = saved_;
+	}
+
+	SeededRNGScope(const SeededRNGScope &) = delete;
+	SeededRNGScope &operator=(const SeededRNGScope &) = delete;
+};
+
 /**
  * @brief do the clustering by using only color information on the input image.
  * It maps each pixel in the color space and then do clustering till the termination criteria is reached.
- * To initialize the centers it uses Kmeans++.
+ * To initialize the centers it uses Kmeans++, with a random generator owned by this call and seeded with the given
+ * seed: the result depends only on the input and on the seed, so it is the same on every thread and in parallel
+ * callers, and the random generator of the caller is not modified.
  * @param inputImage image to be clustered.
  * @param colors vector containing the different colors for the different clusters,
  * the size of the vector is the number of output clusters.
  * @param clusteredImage output image: original image clustered
+ * @param seed seed of the random generator used to initialize the centers.
  * @throw invalid_argument if the input image is empty or if colors is empty
  * 						   	or if inputImage has a number of channels different from 3.
  */
-void kMeansClustering(const Mat &inputImage, const vector<Vec3b> &colors, Mat &clusteredImage){
+void kMeansClustering(const Mat &inputImage, const vector<Vec3b> &colors, Mat &clusteredImage,
+					  uint64_t seed /*= KMEANS_SEED*/){
 
 	if(colors.empty())
 		throw invalid_argument("Empty color vector");
@@ -168,7 +228,6 @@ void kMeansClustering(const Mat &inputImage, const vector<Vec3b> &colors, Mat &c
 	Mat samples, labels;
 	const int ATTEMPTS = 10;
 	samples = Mat(inputImage.total(), 3, CV_32F);
-	theRNG().state = 123456789; //fixed random state to have centers used to tune the rest of the program
 
 	int index = 0;
 	for(int i = 0; i < inputImage.rows; i++){
@@ -182,7 +241,10 @@ void kMeansClustering(const Mat &inputImage, const vector<Vec3b> &colors, Mat &c
 	}
 
 	const TermCriteria CRITERIA = TermCriteria(TermCriteria::EPS, 0, 1.0);
-	kmeans(samples, clusterCount, labels, CRITERIA, ATTEMPTS, KMEANS_PP_CENTERS);
+	{
+		SeededRNGScope rngScope = SeededRNGScope(seed);
+		kmeans(samples, clusterCount, labels, CRITERIA, ATTEMPTS, KMEANS_PP_CENTERS);
+	}
 	clusteredImage = Mat(inputImage.size(), CV_8UC3);
 
 	int cluster_idx = -1;
@@ -277,9 +339,21 @@ void separateResultGT(const vector<pair<Rect, Category>> &gt,
  * @param output output image containing the input image with the bounding boxes.
  */
 void drawBoundingBoxes(const Mat &img, Table &table, Mat &output) {
+	drawBoundingBoxes(img, table, *table.ballsPtr(), output);
+}
+
+/**
+ * @brief Draw the bounding boxes of the given balls and the table boundaries on the output image.
+ * Used when the balls of the image are not the ones of the table, for example in an interpolated frame.
+ * @param img input image.
+ * @param table table containing the boundaries.
+ * @param balls balls in the input image.
+ * @param output output image containing the input image with the bounding boxes.
+ */
+void drawBoundingBoxes(const Mat &img, const Table &table, const vector<Ball> &balls, Mat &output) {
 	output = img.clone();
 	Scalar border_color = Scalar(0, 255, 255); // color of the borders of the table
-	for(const Ball &ball : *table.ballsPtr()) {
+	for(const Ball &ball : balls) {
 		Rect bbox = ball.getBbox();
 		if(ball.getVisibility())
 			switch (ball.getCategory()){
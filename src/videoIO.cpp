@@ -0,0 +1,305 @@
+// Author: Michele Sprocatti
+
+#include "videoIO.h"
+
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <stdexcept>
+
+using namespace std;
+using namespace cv;
+using namespace chrono;
+
+// backends and codecs explored by the benchmark, the built-in MJPEG encoder writes only MJPEG;
+// the raw frames are not selected automatically since the output would be tens of times larger
+const vector<int> BENCHMARK_BACKENDS = {CAP_FFMPEG, CAP_GSTREAMER};
+const vector<int> BENCHMARK_WRITER_BACKENDS = {CAP_FFMPEG, CAP_GSTREAMER, CAP_OPENCV_MJPEG};
+const vector<VideoCodec> BENCHMARK_CODECS = {CODEC_MPEG4, CODEC_H264, CODEC_MJPEG};
+
+/**
+ * @brief Return the fourcc code of a codec.
+ * @param codec codec of the video.
+ * @return the fourcc code.
+ */
+int codecFourcc(VideoCodec codec) {
+	switch (codec) {
+		case CODEC_H264:
+			return VideoWriter::fourcc('a', 'v', 'c', '1');
+		case CODEC_MJPEG:
+			return VideoWriter::fourcc('M', 'J', 'P', 'G');
+		case CODEC_RAW:
+			return 0;
+		default:
+			return VideoWriter::fourcc('m', 'p', '4', 'v');
+	}
+}
+
+/**
+ * @brief Return the extension of the container of a codec.
+ * @param codec codec of the video.
+ * @return the extension, with the dot.
+ */
+string codecExtension(VideoCodec codec) {
+	if (codec == CODEC_MJPEG || codec == CODEC_RAW)
+		return ".avi";
+	return ".mp4";
+}
+
+/**
+ * @brief Return the name of a backend.
+ * @param backend backend identifier.
+ * @return the name.
+ */
+string backendName(int backend) {
+	if (backend == CAP_ANY)
+		return "default";
+	return videoio_registry::getBackendName(static_cast<VideoCaptureAPIs>(backend));
+}
+
+/**
+ * @brief Return a readable description of a configuration.
+ * @param config configuration.
+ * @return the description.
+ */
+string describeVideoIO(const VideoIOConfig &config) {
+	const string CODEC_NAMES[] = {"MPEG-4", "H.264", "MJPEG", "raw"};
+	return "decoder " + backendName(config.captureBackend) + " with "
+		   + (config.captureThreads > 0 ? to_string(config.captureThreads) : string("default")) + " threads, encoder "
+		   + backendName(config.writerBackend) + " " + CODEC_NAMES[config.codec] + " quality " + to_string(config.quality);
+}
+
+/**
+ * @brief Open a video for reading with the given configuration, on the CPU.
+ * @param capture output decoder.
+ * @param path path of the video.
+ * @param config configuration of the decoder.
+ * @return true if the video has been opened.
+ */
+bool openCapture(VideoCapture &capture, const string &path, const VideoIOConfig &config) {
+	vector<int> params = {CAP_PROP_HW_ACCELERATION, VIDEO_ACCELERATION_NONE};
+	if (config.captureThreads > 0) {
+		params.push_back(CAP_PROP_N_THREADS);
+		params.push_back(config.captureThreads);
+	}
+	try {
+		return capture.open(path, config.captureBackend, params);
+	} catch (const Exception &) {
+		return false;
+	}
+}
+
+/**
+ * @brief Open a video for writing with the given configuration, on the CPU.
+ * The default configuration opens the writer as before, without properties, and the quality is passed
+ * only to the built-in MJPEG encoder, since the other backends refuse to open with it.
+ * @param writer output encoder.
+ * @param path path of the video, its extension should match the codec.
+ * @param fps frames per second of the video.
+ * @param frameSize size of the frames.
+ * @param config configuration of the encoder.
+ * @return true if the video has been opened.
+ */
+bool openWriter(VideoWriter &writer, const string &path, double fps, Size frameSize, const VideoIOConfig &config) {
+	vector<int> params = {VIDEOWRITER_PROP_HW_ACCELERATION, VIDEO_ACCELERATION_NONE};
+	if (config.writerBackend == CAP_OPENCV_MJPEG && config.codec == CODEC_MJPEG) {
+		params.push_back(VIDEOWRITER_PROP_QUALITY);
+		params.push_back(config.quality);
+	}
+	try {
+		if (config.writerBackend == CAP_ANY && config.codec == CODEC_MPEG4)
+			return writer.open(path, codecFourcc(config.codec), fps, frameSize, true);
+		return writer.open(path, config.writerBackend, codecFourcc(config.codec), fps, frameSize, params);
+	} catch (const Exception &) {
+		return false;
+	}
+}
+
+/**
+ * @brief Measure the decoding speed of the available decoder configurations on a video.
+ * For each backend the default number of threads, a single thread and one thread per CPU are tried.
+ * The frames for the encoders are read before the measures, so no configuration is charged for their copies.
+ * @param videoPath path of the video.
+ * @param frames output first frames of the video, used to benchmark the encoders.
+ * @return the result of each configuration.
+ */
+vector<VideoIOBenchmark> benchmarkDecoders(const string &videoPath, vector<Mat> &frames) {
+	vector<int> threads = {0, 1};
+	if (getNumberOfCPUs() > 1)
+		threads.push_back(getNumberOfCPUs());
+
+	VideoCapture sampleCapture;
+	if (openCapture(sampleCapture, videoPath, VideoIOConfig())) {
+		Mat frame;
+		while (frames.size() < VIDEO_IO_BENCHMARK_FRAMES && sampleCapture.read(frame))
+			frames.push_back(frame.clone());
+	}
+
+	vector<VideoIOBenchmark> results;
+	for (int backend : BENCHMARK_BACKENDS) {
+		for (int thread : threads) {
+			VideoIOBenchmark result;
+			result.config.captureBackend = backend;
+			result.config.captureThreads = thread;
+			result.available = false;
+			result.fps = 0;
+
+			VideoCapture capture;
+			if (openCapture(capture, videoPath, result.config)) {
+				Mat frame;
+				int count = 0;
+				time_point<steady_clock> start = steady_clock::now();
+				while (count < VIDEO_IO_BENCHMARK_FRAMES && capture.read(frame))
+					count++;
+				double seconds = duration<double>(steady_clock::now() - start).count();
+				result.available = count > 0;
+				result.fps = (count > 0) ? count / seconds : 0;
+			}
+			results.push_back(result);
+		}
+	}
+	return results;
+}
+
+/**
+ * @brief Measure the encoding speed of the available encoder configurations.
+ * The frames are encoded in a temporary file, which is removed after the measure.
+ * @param frames frames to encode.
+ * @param fps frames per second of the video.
+ * @return the result of each configuration.
+ */
+vector<VideoIOBenchmark> benchmarkEncoders(const vector<Mat> &frames, double fps) {
+	vector<VideoIOBenchmark> results;
+	if (frames.empty())
+		return results;
+
+	for (int backend : BENCHMARK_WRITER_BACKENDS) {
+		for (VideoCodec codec : BENCHMARK_CODECS) {
+			if (backend == CAP_OPENCV_MJPEG && codec != CODEC_MJPEG)
+				continue;
+			VideoIOBenchmark result;
+			result.config.writerBackend = backend;
+			result.config.codec = codec;
+			result.available = false;
+			result.fps = 0;
+
+			filesystem::path path = filesystem::temp_directory_path() / ("video_io_benchmark" + codecExtension(codec));
+			VideoWriter writer;
+			if (openWriter(writer, path.string(), fps, frames[0].size(), result.config)) {
+				time_point<steady_clock> start = steady_clock::now();
+				for (const Mat &frame : frames)
+					writer.write(frame);
+				writer.release();	// the encoder is flushed, so the pending frames are measured too
+				double seconds = duration<double>(steady_clock::now() - start).count();
+
+				error_code error;
+				result.available = filesystem::exists(path, error) && filesystem::file_size(path, error) > 0;
+				result.fps = result.available ? frames.size() / seconds : 0;
+				filesystem::remove(path, error);
+			}
+			results.push_back(result);
+		}
+	}
+	return results;
+}
+
+/**
+ * @brief Read the choices for each container from a file.
+ * @param choicesPath path of the file.
+ * @return the configuration of each container.
+ */
+map<string, VideoIOConfig> readVideoIOChoices(const string &choicesPath) {
+	map<string, VideoIOConfig> choices;
+	error_code error;
+	if (!filesystem::exists(choicesPath, error))
+		return choices;
+
+	FileStorage fs(choicesPath, FileStorage::READ);
+	if (!fs.isOpened())
+		return choices;
+	FileNode root = fs.root();
+	for (FileNodeIterator it = root.begin(); it != root.end(); ++it) {
+		FileNode node = *it;
+		VideoIOConfig config;
+		config.captureBackend = (int) node["captureBackend"];
+		config.captureThreads = (int) node["captureThreads"];
+		config.writerBackend = (int) node["writerBackend"];
+		config.codec = static_cast<VideoCodec>((int) node["codec"]);
+		config.quality = (int) node["quality"];
+		choices[node.name()] = config;
+	}
+	return choices;
+}
+
+/**
+ * @brief Save the choices for each container in a file.
+ * @param choicesPath path of the file.
+ * @param choices configuration of each container.
+ */
+void writeVideoIOChoices(const string &choicesPath, const map<string, VideoIOConfig> &choices) {
+	FileStorage fs(choicesPath, FileStorage::WRITE);
+	for (const pair<const string, VideoIOConfig> &choice : choices) {
+		fs << choice.first << "{";
+		fs << "captureBackend" << choice.second.captureBackend;
+		fs << "captureThreads" << choice.second.captureThreads;
+		fs << "writerBackend" << choice.second.writerBackend;
+		fs << "codec" << static_cast<int>(choice.second.codec);
+		fs << "quality" << choice.second.quality;
+		fs << "}";
+	}
+}
+
+/**
+ * @brief Select the fastest decoder and encoder for the container of a video.
+ * The decoders are measured on the video and the encoders on its first frames, only the CPU paths are considered.
+ * The choice for each container is saved in a file, so the benchmark runs only the first time.
+ * @param videoPath path of the video.
+ * @param choicesPath path of the file with the choices for each container.
+ * @return the fastest configuration.
+ * @throw invalid_argument if the video cannot be read or no encoder is available.
+ */
+VideoIOConfig selectFastestVideoIO(const string &videoPath, const string &choicesPath) {
+	// the keys of the file must start with a letter
+	string container = filesystem::path(videoPath).extension().string();
+	std::transform(container.begin(), container.end(), container.begin(), [](unsigned char c) {
+		return isalnum(c) ? tolower(c) : '_';
+	});
+	container = "container" + container;
+
+	map<string, VideoIOConfig> choices = readVideoIOChoices(choicesPath);
+	if (choices.count(container) > 0)
+		return choices[container];
+
+	vector<Mat> frames;
+	vector<VideoIOBenchmark> decoders = benchmarkDecoders(videoPath, frames);
+	VideoCapture capture = VideoCapture(videoPath);
+	double fps = capture.isOpened() ? capture.get(CAP_PROP_FPS) : 0;
+	if (fps <= 0)
+		fps = 30;
+	vector<VideoIOBenchmark> encoders = benchmarkEncoders(frames, fps);
+
+	const VideoIOBenchmark *bestDecoder = nullptr;
+	for (const VideoIOBenchmark &decoder : decoders)
+		if (decoder.available && (bestDecoder == nullptr || decoder.fps > bestDecoder->fps))
+			bestDecoder = &decoder;
+	const VideoIOBenchmark *bestEncoder = nullptr;
+	for (const VideoIOBenchmark &encoder : encoders)
+		if (encoder.available && (bestEncoder == nullptr || encoder.fps > bestEncoder->fps))
+			bestEncoder = &encoder;
+
+	if (bestDecoder == nullptr)
+		throw invalid_argument("No decoder can read " + videoPath);
+	if (bestEncoder == nullptr)
+		throw invalid_argument("No encoder available");
+
+	VideoIOConfig config = bestDecoder->config;
+	config.writerBackend = bestEncoder->config.writerBackend;
+	config.codec = bestEncoder->config.codec;
+
+	choices[container] = config;
+	writeVideoIOChoices(choicesPath, choices);
+	return config;
+}